@@ -0,0 +1,76 @@
+#pragma once
+#include <time.h>       // clock_gettime
+#include <algorithm>    // std::sort
+#include <cstdint>      // uint64_t
+#include <cstdio>       // printf
+#include <vector>
+#include "tracer_counters.hpp"
+
+/* Helpers shared by the benchmark programs. Every result is one line of
+   space-separated key=value pairs starting with benchmark=<name>, so runs
+   of different library versions, tracing modes or machines can be
+   compared with grep and awk. */
+
+static inline uint64_t benchmark_clock() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief Mean and quantiles of a set of durations in ns.
+ */
+struct latency_summary {
+	size_t n;
+	uint64_t mean;
+	uint64_t min;
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t max;
+};
+
+static inline struct latency_summary summarize(std::vector<uint64_t> samples) {
+	struct latency_summary summary = {};
+	if(samples.empty()) {
+		return summary;
+	}
+	std::sort(samples.begin(), samples.end());
+	uint64_t sum = 0;
+	for(uint64_t sample : samples) {
+		sum += sample;
+	}
+	summary.n = samples.size();
+	summary.mean = sum / samples.size();
+	summary.min = samples.front();
+	summary.p50 = samples[samples.size() / 2];
+	summary.p99 = samples[samples.size() * 99 / 100];
+	summary.max = samples.back();
+	return summary;
+}
+
+/**
+ * @brief Print `summary` as key=value pairs with the given key prefix,
+ * e.g. "round_trip" gives round_trip_mean_ns=... round_trip_p99_ns=...
+ */
+static inline void print_summary(const char *prefix, const struct latency_summary& summary) {
+	printf(" %s_mean_ns=%lu %s_min_ns=%lu %s_p50_ns=%lu %s_p99_ns=%lu %s_max_ns=%lu",
+	       prefix, summary.mean, prefix, summary.min, prefix, summary.p50,
+	       prefix, summary.p99, prefix, summary.max);
+}
+
+/**
+ * @brief If libtracer was built with `COUNTERS=1`, print one line with
+ * its counters since the last `tracer_counters_reset`, for the run
+ * described by `run` (e.g. "benchmark=syscall_stops mode=ptrace").
+ */
+static inline void print_counters(const char *run) {
+	const struct tracer_counters counters = tracer_counters_snapshot();
+	if(!counters.enabled) {
+		return;
+	}
+	printf("%s counters=1", run);
+	for(int i = 0; i < N_TRACER_COUNTERS; i++) {
+		printf(" %s=%lu", tracer_counter_name((enum tracer_counter)i), counters.counts[i]);
+	}
+	printf(" elapsed_time_ns=%lu tracer_cpu_time_ns=%lu\n", counters.elapsed_time, counters.tracer_cpu_time);
+}
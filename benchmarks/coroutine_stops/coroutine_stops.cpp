@@ -0,0 +1,54 @@
+#include <unistd.h>       // _exit
+#include <sys/syscall.h>  // syscall, SYS_getppid
+#include <chrono>
+#include <cstdio>         // printf
+#include <cstdlib>        // atol
+#include "tracer_coroutine.hpp"
+
+/* Stops per second handed out by a `tracer_scheduler`, with the same total
+   number of system calls spread over 1 and over 1000 tracees (or the
+   counts given on the command line). Each tracee calls getppid in a loop,
+   and its task awaits every entry and exit. */
+
+static const long total_syscalls = 100000;
+
+static long stops = 0;
+
+static tracer_task trace(tracer_scheduler& scheduler, tracer& tracee) {
+	const enum stop_reason stops_awaited[] = { SYSCALL_ENTRY, SYSCALL_EXIT };
+	size_t i = 0;
+	while(co_await scheduler.next(tracee, stops_awaited[i])) {
+		stops++;
+		i = 1 - i;
+	}
+}
+
+static void run(long n_tracees) {
+	const long syscalls_per_tracee = total_syscalls / n_tracees;
+	tracer_scheduler scheduler(trace);
+	for(long i = 0; i < n_tracees; i++) {
+		if(scheduler.fork() == 0) {
+			for(long j = 0; j < syscalls_per_tracee; j++) {
+				syscall(SYS_getppid);
+			}
+			_exit(0);
+		}
+	}
+	stops = 0;
+	const auto start = std::chrono::steady_clock::now();
+	scheduler.run();
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("benchmark=coroutine_stops tracees=%ld stops=%ld seconds=%.3f stops_per_second=%.0f\n",
+	       n_tracees, stops, seconds, stops / seconds);
+}
+
+int main(int argc, char **argv) {
+	if(argc < 2) {
+		run(1);
+		run(1000);
+	}
+	for(int i = 1; i < argc; i++) {
+		run(atol(argv[i]));
+	}
+	return 0;
+}
@@ -0,0 +1,79 @@
+#include <unistd.h>       // fork, pause, _exit
+#include <signal.h>       // kill, SIGKILL
+#include <sys/wait.h>     // waitpid
+#include <cstdio>         // printf
+#include <cstdlib>        // atol
+#include <string>
+#include <vector>
+#include "tracer.hpp"
+#include "benchmark.hpp"
+
+/* Time to start tracing a process: `tracer::fork` until it returns in the
+   tracer with the child stopped, and `attach` and `seize` to a running
+   untraced child, each followed by `detach`. Forked tracees exit right
+   away; the time until their `EXITED` stop is reported as well. */
+
+static const long default_repetitions = 1000;
+
+static void run_fork(long repetitions) {
+	std::vector<uint64_t> fork_times;
+	std::vector<uint64_t> exit_times;
+	tracer_counters_reset();
+	for(long i = 0; i < repetitions; i++) {
+		tracer tracee;
+		const uint64_t start = benchmark_clock();
+		if(tracee.fork() == 0) {
+			_exit(0);
+		}
+		const uint64_t forked = benchmark_clock();
+		tracee.resume_and_wait(EXITED);
+		fork_times.push_back(forked - start);
+		exit_times.push_back(benchmark_clock() - forked);
+	}
+	printf("benchmark=fork_attach mode=fork repetitions=%ld", repetitions);
+	print_summary("fork", summarize(fork_times));
+	print_summary("exit", summarize(exit_times));
+	printf("\n");
+	print_counters("benchmark=fork_attach mode=fork");
+}
+
+static void run_attach(bool seize, long repetitions) {
+	const pid_t pid = fork();
+	if(pid == 0) {
+		for(;;) {
+			pause();
+		}
+	}
+	std::vector<uint64_t> attach_times;
+	std::vector<uint64_t> detach_times;
+	tracer_counters_reset();
+	for(long i = 0; i < repetitions; i++) {
+		tracer tracee;
+		const uint64_t start = benchmark_clock();
+		if(seize) {
+			tracee.seize(pid);
+		} else {
+			tracee.attach(pid);
+		}
+		const uint64_t attached = benchmark_clock();
+		tracee.detach();
+		attach_times.push_back(attached - start);
+		detach_times.push_back(benchmark_clock() - attached);
+	}
+	const std::string run = std::string("benchmark=fork_attach mode=") + (seize ? "seize" : "attach");
+	printf("%s repetitions=%ld", run.c_str(), repetitions);
+	print_summary("attach", summarize(attach_times));
+	print_summary("detach", summarize(detach_times));
+	printf("\n");
+	print_counters(run.c_str());
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+}
+
+int main(int argc, char **argv) {
+	const long repetitions = (argc >= 2 ? atol(argv[1]) : default_repetitions);
+	run_fork(repetitions);
+	run_attach(false, repetitions);
+	run_attach(true, repetitions);
+	return 0;
+}
@@ -0,0 +1,76 @@
+#include <unistd.h>       // fork, _exit
+#include <sys/wait.h>     // waitpid
+#include <algorithm>      // std::max
+#include <cerrno>         // errno, ECHILD
+#include <cstdio>         // printf
+#include <cstdlib>        // atol
+#include <string>
+#include "tracer_session.hpp"
+#include "benchmark.hpp"
+
+/* A tracee forks a number of children as fast as it can, each of which
+   exits right away, and then reaps them. Measures how long a
+   `tracer_session` takes to follow the whole storm, resuming every tracee
+   until its next fork event only, or until its next system call entry as
+   strace would, compared to the same storm untraced. */
+
+static const long default_children = 1000;
+
+enum mode {
+	MODE_UNTRACED,
+	MODE_FORK_EVENTS,
+	MODE_SYSCALLS,
+};
+
+static const char *const mode_names[] = { "untraced", "fork_events", "syscalls" };
+
+static void storm(long children) {
+	for(long i = 0; i < children; i++) {
+		if(fork() == 0) {
+			_exit(0);
+		}
+	}
+	while(waitpid(-1, NULL, 0) != -1 || errno != ECHILD);
+	_exit(0);
+}
+
+static void run(enum mode mode, long children) {
+	long events = 0;
+	size_t max_tracees = 0;
+	tracer_counters_reset();
+	const uint64_t start = benchmark_clock();
+	if(mode == MODE_UNTRACED) {
+		const pid_t pid = fork();
+		if(pid == 0) {
+			storm(children);
+		}
+		waitpid(pid, NULL, 0);
+	} else {
+		tracer_session session;
+		if(session.fork() == 0) {
+			storm(children);
+		}
+		const enum stop_reason until = (mode == MODE_SYSCALLS ? SYSCALL_ENTRY : FORKED);
+		struct tracer_event event;
+		while(session.next_event(event)) {
+			events++;
+			max_tracees = std::max(max_tracees, session.size());
+			if(event.stop_reason != EXITED) {
+				event.tracer->resume(until);
+			}
+		}
+	}
+	const double seconds = (benchmark_clock() - start) / 1e9;
+	const std::string run = std::string("benchmark=fork_storm mode=") + mode_names[mode];
+	printf("%s children=%ld events=%ld max_tracees=%zu seconds=%.3f forks_per_second=%.0f\n",
+	       run.c_str(), children, events, max_tracees, seconds, children / seconds);
+	print_counters(run.c_str());
+}
+
+int main(int argc, char **argv) {
+	const long children = (argc >= 2 ? atol(argv[1]) : default_children);
+	run(MODE_UNTRACED, children);
+	run(MODE_FORK_EVENTS, children);
+	run(MODE_SYSCALLS, children);
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include <signal.h>       // kill, SIGKILL
+#include <sys/syscall.h>  // syscall, SYS_getppid
+#include <algorithm>      // std::min, std::max
+#include <cstdio>         // printf
+#include <cstdlib>        // atol
+#include <cstring>        // memset
+#include <iterator>       // std::begin, std::end
+#include <string>
+#include <vector>
+#include "tracer.hpp"
+#include "benchmark.hpp"
+
+/* Throughput of reading tracee memory, by buffer size: word by word with
+   `read_word`, and in one go with `read_memory`, for each memory backend.
+   The buffer is allocated before forking, so it is at the same address in
+   the tracee. Before each read, the tracee is resumed to its next getppid
+   entry, which drops the memory cache; only the read itself is timed. */
+
+static const size_t default_sizes[] = { 8, 64, 512, 4096, 32768, 262144, 1048576 };
+
+static const size_t bytes_per_size = 4 << 20;  // Read this much per size, in as many iterations as needed
+static const long min_iterations = 4;
+static const long max_iterations = 10000;
+
+enum method {
+	METHOD_READ_WORD,
+	METHOD_READ_MEMORY,
+};
+
+static const char *const method_names[] = { "read_word", "read_memory" };
+static const char *const backend_names[] = { "ptrace", "process_vm", "proc_mem" };
+
+static volatile long sink;
+
+static void run(enum method method, enum memory_backend backend, const std::vector<size_t>& sizes) {
+	const size_t buffer_size = *std::max_element(sizes.begin(), sizes.end());
+	std::vector<char> buffer(buffer_size);
+	memset(buffer.data(), 1, buffer_size);
+	std::vector<char> destination(buffer_size);
+
+	tracer tracee;
+	pid_t pid = tracee.fork();
+	if(pid == 0) {
+		for(;;) {
+			syscall(SYS_getppid);
+		}
+	}
+	tracee.set_memory_backend(backend);
+	tracer_counters_reset();
+	for(size_t size : sizes) {
+		const long iterations = std::min(max_iterations, std::max(min_iterations, (long)(bytes_per_size / size)));
+		uint64_t total_time = 0;
+		for(long i = 0; i < iterations; i++) {
+			tracee.resume_and_wait(SYSCALL_ENTRY);
+			const uint64_t start = benchmark_clock();
+			if(method == METHOD_READ_WORD) {
+				for(size_t offset = 0; offset + sizeof(long) <= size; offset += sizeof(long)) {
+					sink = sink + tracee.read_word(buffer.data() + offset);
+				}
+			} else if(tracee.read_memory(buffer.data(), destination.data(), size) != size) {
+				throw tracer_exception("Short read from tracee.");
+			}
+			total_time += benchmark_clock() - start;
+		}
+		const double seconds = total_time / 1e9;
+		printf("benchmark=read_memory method=%s backend=%s cache_pages=%zu bytes=%zu iterations=%ld seconds=%.3f read_ns=%lu mb_per_second=%.1f\n",
+		       method_names[method], backend_names[backend], tracee.memory_cache_pages(),
+		       size, iterations, seconds, total_time / iterations,
+		       (double)size * iterations / seconds / (1 << 20));
+	}
+	const std::string run = std::string("benchmark=read_memory method=") + method_names[method]
+	                        + " backend=" + backend_names[backend];
+	print_counters(run.c_str());
+	kill(pid, SIGKILL);
+	tracee.resume_and_wait(EXITED);
+}
+
+int main(int argc, char **argv) {
+	std::vector<size_t> sizes(std::begin(default_sizes), std::end(default_sizes));
+	if(argc >= 2) {
+		sizes.clear();
+		for(int i = 1; i < argc; i++) {
+			sizes.push_back(atol(argv[i]));
+		}
+	}
+	for(enum method method : { METHOD_READ_WORD, METHOD_READ_MEMORY }) {
+		for(enum memory_backend backend : { MEMORY_PTRACE, MEMORY_PROCESS_VM, MEMORY_PROC_MEM }) {
+			run(method, backend, sizes);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include <unistd.h>       // _exit
+#include <sys/syscall.h>  // syscall, SYS_getppid
+#include <cstdio>         // printf
+#include <cstdlib>        // atol
+#include <vector>
+#include "tracer.hpp"
+#include "benchmark.hpp"
+
+/* Cost of `read_registers`: at each of a number of getppid entry stops,
+   the first read asks the kernel, and the reads after it until the tracee
+   is resumed are served from the register cache. */
+
+static const long default_stops = 20000;
+
+static const int cached_reads_per_stop = 100;
+
+static volatile long sink;
+
+static void run(long stops) {
+	tracer tracee;
+	if(tracee.fork() == 0) {
+		for(long i = 0; i < stops + 1; i++) {
+			syscall(SYS_getppid);
+		}
+		_exit(0);
+	}
+	std::vector<uint64_t> uncached;
+	std::vector<uint64_t> cached;
+	uncached.reserve(stops);
+	cached.reserve(stops);
+	tracer_counters_reset();
+	for(long i = 0; i < stops; i++) {
+		if(!tracee.resume_and_wait(SYSCALL_ENTRY)) {
+			throw tracer_exception("Tracee exited early.");
+		}
+		const uint64_t start = benchmark_clock();
+		sink = sink + *(const long *)&tracee.read_registers();
+		const uint64_t first_read = benchmark_clock();
+		for(int j = 0; j < cached_reads_per_stop; j++) {
+			sink = sink + *(const long *)&tracee.read_registers();
+		}
+		uncached.push_back(first_read - start);
+		cached.push_back((benchmark_clock() - first_read) / cached_reads_per_stop);
+	}
+	printf("benchmark=registers stops=%ld cached_reads_per_stop=%d", stops, cached_reads_per_stop);
+	print_summary("uncached", summarize(uncached));
+	print_summary("cached", summarize(cached));
+	printf("\n");
+	print_counters("benchmark=registers");
+	tracee.resume_and_wait(EXITED);
+}
+
+int main(int argc, char **argv) {
+	run(argc >= 2 ? atol(argv[1]) : default_stops);
+	return 0;
+}
@@ -0,0 +1,73 @@
+#include <unistd.h>       // _exit
+#include <sys/syscall.h>  // syscall, SYS_getppid
+#include <cstdio>         // printf
+#include <cstdlib>        // atol
+#include <string>
+#include <vector>
+#include "tracer.hpp"
+#include "benchmark.hpp"
+
+/* Round-trip latency of a system call stop: the time from resuming a
+   tracee stopped at the exit of one getppid call until it is stopped at
+   the exit of the next, i.e. one `resume_and_wait(SYSCALL_ENTRY)` and one
+   `resume_and_wait(SYSCALL_EXIT)`, reading the system call number at each
+   entry. Measured for both syscall info backends, and with a seccomp
+   filter selecting getppid. */
+
+static const long default_round_trips = 20000;
+
+enum mode {
+	MODE_REGISTERS,
+	MODE_PTRACE_SYSCALL_INFO,
+	MODE_SECCOMP,
+};
+
+static const char *const mode_names[] = { "registers", "ptrace_syscall_info", "seccomp" };
+
+static void run(enum mode mode, long round_trips) {
+	tracer tracee;
+	pid_t pid = (mode == MODE_SECCOMP ? tracee.fork({ SYS_getppid }) : tracee.fork());
+	if(pid == 0) {
+		for(long i = 0; i < round_trips + 1; i++) {
+			syscall(SYS_getppid);
+		}
+		_exit(0);
+	}
+	if(mode == MODE_PTRACE_SYSCALL_INFO) {
+		tracee.set_syscall_info_backend(SYSCALL_INFO_PTRACE);
+	}
+	const enum stop_reason entry = (mode == MODE_SECCOMP ? SECCOMP : SYSCALL_ENTRY);
+
+	// Get to the exit of the first getppid, past whatever ran before it.
+	while(tracee.resume_and_wait(entry) && tracee.get_syscall_number() != SYS_getppid);
+	tracee.resume_and_wait(SYSCALL_EXIT);
+
+	std::vector<uint64_t> samples;
+	samples.reserve(round_trips);
+	tracer_counters_reset();
+	const uint64_t start = benchmark_clock();
+	for(long i = 0; i < round_trips; i++) {
+		const uint64_t round_trip_start = benchmark_clock();
+		if(!tracee.resume_and_wait(entry) || tracee.get_syscall_number() != SYS_getppid
+		   || !tracee.resume_and_wait(SYSCALL_EXIT)) {
+			throw tracer_exception("Tracee stopped calling getppid.");
+		}
+		samples.push_back(benchmark_clock() - round_trip_start);
+	}
+	const double seconds = (benchmark_clock() - start) / 1e9;
+	const std::string run = std::string("benchmark=syscall_stops mode=") + mode_names[mode];
+	printf("%s round_trips=%ld seconds=%.3f round_trips_per_second=%.0f",
+	       run.c_str(), round_trips, seconds, round_trips / seconds);
+	print_summary("round_trip", summarize(samples));
+	printf("\n");
+	print_counters(run.c_str());
+	tracee.resume_and_wait(EXITED);
+}
+
+int main(int argc, char **argv) {
+	const long round_trips = (argc >= 2 ? atol(argv[1]) : default_round_trips);
+	run(MODE_REGISTERS, round_trips);
+	run(MODE_PTRACE_SYSCALL_INFO, round_trips);
+	run(MODE_SECCOMP, round_trips);
+	return 0;
+}
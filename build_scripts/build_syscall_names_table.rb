@@ -2,6 +2,9 @@
 
 # This script generates the table of system call names, by parsing 
 # architecure-specific system call information in the 'asm/unistd.h' header.
+# Alongside it, it generates a perfect hash index for looking up system call
+# numbers by name, and the table of system call signatures described in
+# build_scripts/syscall_signatures.txt.
 
 require 'set'
 
@@ -19,6 +22,8 @@ tracer_dir = ENV.fetch("TRACER_DIR", ".")
 unistd_include = "asm/unistd.h"
 output_file = "#{tracer_dir}/src/generated/syscall_names_table.cpp"
 temp_file_name = "#{tracer_dir}/build/tracer_temp_syscall_enumerator"
+signatures_file = "#{tracer_dir}/build_scripts/syscall_signatures.txt"
+signature_header = "#{tracer_dir}/include/syscall_signature.hpp"
 
 if ARGV.length >= 1
 	output_file = ARGV[0]
@@ -42,7 +47,7 @@ print "#{$PROGRAM_NAME}  cc: #{cc}  unistd_include: #{unistd_include}  output_fi
 # #define __NR_openat 52
 syscall_def_regex = /^#define[[:blank:]]+(__NR(3264)?_([[:graph:]]+))[[:blank:]]+([[:graph:]]+)/
 
-definitions = SortedSet.new
+definitions = Set.new
 
 result = pexec("echo \"#include <#{unistd_include}>\" | #{cc} -dM -E -xc - -o-")
 abort "could not gather list of system calls\n" if not $?.success?
@@ -60,7 +65,7 @@ source = "
 #include <#{unistd_include}>
 #include <stdio.h>
 int main(int argc, char **argv) {
-	#{definitions.map { |x| "printf(\"#define #{x} %d\\\\n\", #{x});" }.join("\n")}
+	#{definitions.sort.map { |x| "printf(\"#define #{x} %d\\\\n\", #{x});" }.join("\n")}
 	return 0;
 }
 "
@@ -94,6 +99,120 @@ result.each_line do |line|
 	max_syscall_number = [max_syscall_number, number].max
 end
 
+# Perfect hash for name -> number lookups ("hash, displace" scheme)
+#
+# Every name is first hashed with seed 0 into one of `hash_size` buckets.
+# Each bucket then gets a seed under which all its names land in distinct,
+# otherwise unoccupied slots. Buckets with a single name are instead pointed
+# directly at a free slot by storing -(slot + 1) as their seed. A lookup
+# thus costs two hashes and one string comparison, and needs no allocation.
+#
+# The hash function must be kept in sync with syscall_name_hash in
+# src/generic/tracer.cpp.
+
+def syscall_name_hash(seed, name)
+	hash = 0x811c9dc5 ^ seed
+	name.each_byte do |byte|
+		hash ^= byte
+		hash = (hash * 16777619) & 0xffffffff
+	end
+	return hash
+end
+
+names = name_to_number.keys.sort
+hash_size = names.length
+buckets = Array.new(hash_size) { [] }
+names.each { |name| buckets[syscall_name_hash(0, name) % hash_size] << name }
+hash_seeds = Array.new(hash_size, 0)
+hash_slots = Array.new(hash_size, nil)
+
+order = (0...hash_size).sort_by { |i| [-buckets[i].length, i] }
+order.each do |i|
+	bucket = buckets[i]
+	break if bucket.length <= 1
+	seed = 1
+	loop do
+		slots = bucket.map { |name| syscall_name_hash(seed, name) % hash_size }
+		break if slots.uniq.length == slots.length and slots.none? { |slot| hash_slots[slot] }
+		seed += 1
+	end
+	hash_seeds[i] = seed
+	bucket.each { |name| hash_slots[syscall_name_hash(seed, name) % hash_size] = name_to_number[name] }
+end
+free_slots = (0...hash_size).select { |slot| hash_slots[slot].nil? }
+order.each do |i|
+	next if buckets[i].length != 1
+	slot = free_slots.shift
+	hash_seeds[i] = -slot - 1
+	hash_slots[slot] = name_to_number[buckets[i][0]]
+end
+# Slots left over (only if there are no names at all) map to no system call.
+hash_slots.map! { |number| number.nil? ? -1 : number }
+
+# System call signatures
+#
+# Each line of the specification reads `name(argument, ...) return`; see
+# the comment at the top of syscall_signatures.txt for the vocabulary.
+# Struct type names are checked against enum syscall_struct_type.
+
+struct_types = Set.new(File.read(signature_header).scan(/\bSYSCALL_STRUCT_([A-Z0-9_]+)\b/).flatten)
+argument_kinds = {
+	"int" => "ARGUMENT_INT", "fd" => "ARGUMENT_FD", "ptr" => "ARGUMENT_POINTER",
+	"str" => "ARGUMENT_STRING", "strv" => "ARGUMENT_STRING_ARRAY",
+	"buf_in" => "ARGUMENT_BUFFER_IN", "buf_out" => "ARGUMENT_BUFFER_OUT",
+	"flags" => "ARGUMENT_FLAGS", "mode" => "ARGUMENT_MODE", "size" => "ARGUMENT_SIZE",
+	"pid" => "ARGUMENT_PID", "sig" => "ARGUMENT_SIGNAL",
+	"struct_in" => "ARGUMENT_STRUCT_IN", "struct_out" => "ARGUMENT_STRUCT_OUT",
+	"struct_inout" => "ARGUMENT_STRUCT_INOUT", "int_out" => "ARGUMENT_INT_OUT",
+	"socklen_inout" => "ARGUMENT_SOCKLEN_INOUT",
+}
+return_kinds = {
+	"int" => "RETURN_INT", "fd" => "RETURN_FD", "size" => "RETURN_SIZE",
+	"ptr" => "RETURN_POINTER", "pid" => "RETURN_PID", "none" => "RETURN_NONE",
+}
+signature_regex = /^([[:alnum:]_]+)\(([^)]*)\)[[:blank:]]+([[:alnum:]_]+)$/
+
+signatures = Hash.new
+File.readlines(signatures_file).each_with_index do |line, i|
+	line = line.sub(/#.*/, "").strip
+	next if line.empty?
+	where = "#{signatures_file}:#{i + 1}"
+	match = line.match(signature_regex)
+	abort "#{where}: malformed signature: #{line}\n" if not match
+	name, arguments, return_kind = match[1], match[2].split(",").map(&:strip), match[3]
+	abort "#{where}: unknown return kind #{return_kind}\n" if not return_kinds.key?(return_kind)
+	abort "#{where}: more than six arguments\n" if arguments.length > 6
+	arguments = arguments.map do |argument|
+		kind, *parameters = argument.split(":")
+		abort "#{where}: unknown argument kind #{kind}\n" if not argument_kinds.key?(kind)
+		struct_type = "SYSCALL_STRUCT_NONE"
+		if kind.start_with?("struct_") then
+			type = parameters.shift
+			abort "#{where}: #{kind} needs a struct type\n" if type.nil?
+			abort "#{where}: unknown struct type #{type}\n" if not struct_types.include?(type.upcase)
+			struct_type = "SYSCALL_STRUCT_#{type.upcase}"
+		end
+		length_argument = -1
+		count = 0
+		if kind == "int_out" then
+			count = Integer(parameters.shift || "1")
+			abort "#{where}: int_out count #{count} out of range\n" if count < 1 or count > 255
+		elsif not parameters.empty? then
+			length_argument = Integer(parameters.shift)
+			abort "#{where}: length argument #{length_argument} out of range\n" if length_argument >= arguments.length
+		end
+		abort "#{where}: #{kind} needs a length argument\n" if kind.start_with?("buf_") and length_argument < 0
+		abort "#{where}: malformed argument #{argument}\n" if not parameters.empty?
+		"{ #{argument_kinds[kind]}, #{length_argument}, #{struct_type}, #{count} }"
+	end
+	signatures[name] = "{ true, #{arguments.length}, #{return_kinds[return_kind]}, { #{arguments.join(", ")} } }"
+end
+
+unknown_signature = "{ false, 6, RETURN_INT, { #{(["{ ARGUMENT_INT, -1, SYSCALL_STRUCT_NONE, 0 }"] * 6).join(", ")} } }"
+number_to_name.each_value do |name|
+	warn "no signature for system call #{name}; decoded as plain integers" if not signatures.key?(name)
+end
+
 # Write out
 File.open(output_file, 'w') do |file|
 	file.write(
@@ -101,13 +220,29 @@ File.open(output_file, 'w') do |file|
 
 // This file was automatically generated by build_scripts/#{$PROGRAM_NAME}
 
-const long tracer::max_syscall_number = #{max_syscall_number};
+const long tracer::_max_syscall_number = #{max_syscall_number};
 
-const char *tracer::syscall_names[] = {
+const char *const tracer::syscall_names[] = {
 	#{(0..max_syscall_number).map { |i|
 		number_to_name.has_key?(i) ? '"' + number_to_name[i] + '"' : 'NULL'
 	}.join(",\n	")}
 };
+
+const size_t tracer::syscall_hash_size = #{hash_size};
+
+const int32_t tracer::syscall_hash_seeds[] = {
+	#{hash_seeds.join(",\n	")}
+};
+
+const int16_t tracer::syscall_hash_slots[] = {
+	#{hash_slots.join(",\n	")}
+};
+
+const struct syscall_signature tracer::syscall_signatures[] = {
+	#{(0..max_syscall_number).map { |i|
+		signatures.fetch(number_to_name[i], unknown_signature)
+	}.join(",\n	")}
+};
 "
 	)
 end
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include <iostream>  // std::cerr
+#include <stdlib.h>  // exit
+#include <unistd.h>  // execvp
+#include <errno.h>   // errno
+#include <signal.h>  // kill, SIGKILL
+#include <string.h>  // strerror
+#include <sys/personality.h>  // personality, ADDR_NO_RANDOMIZE
+#include <sys/wait.h>         // WIFEXITED, WEXITSTATUS
+#include <string>
+#include "tracer.hpp"
+#include "trace_log.hpp"
+#include "syscall_replay.hpp"
+
+/* Records the system calls of a command, with everything the kernel wrote
+   into its memory, and replays them into a later run of the same command
+   without the kernel executing them:
+
+       replay -w trace.log command   # record
+       replay trace.log command      # replay
+
+   Both runs have address space randomization turned off, so that the
+   replayed run gets the same addresses. */
+
+std::ostream& errout = std::cerr;
+
+void exec_command(char **command_argv) {
+	personality(ADDR_NO_RANDOMIZE);
+	if(execvp(command_argv[0], command_argv) == -1) {
+		errout << "execvp() failed: " + std::to_string(errno) + " " + std::string(strerror(errno));
+		exit(1);
+	}
+}
+
+int record(const char *log_path, char **command_argv) {
+	tracer child_tracer;
+	trace_log_writer log(log_path);
+	log.set_capture_mapped_files(true);  // Replay even if the mapped files change
+	if(child_tracer.fork() == 0) {
+		exec_command(command_argv);
+	}
+	while(child_tracer.resume_and_wait(stop_reason::SYSCALL_ENTRY)) {
+		log.syscall_entry(child_tracer);
+		if(!child_tracer.resume_and_wait(stop_reason::SYSCALL_EXIT)) {
+			break;
+		}
+		log.capture_outputs(child_tracer);
+		log.syscall_exit(child_tracer);
+	}
+	log.close();
+	errout << "+++ recorded " + std::to_string(log.events_written()) + " system calls +++\n";
+	return (WIFEXITED(child_tracer.status()) ? WEXITSTATUS(child_tracer.status()) : 1);
+}
+
+int replay(const char *log_path, char **command_argv) {
+	tracer child_tracer;
+	trace_log_reader log(log_path);
+	syscall_replayer replayer(log);
+	if(child_tracer.fork() == 0) {
+		exec_command(command_argv);
+	}
+	replayer.install(child_tracer);
+	try {
+		while(child_tracer.resume_and_wait(stop_reason::EMULATED_SYSCALL)
+		      && replayer.syscall_passthrough(child_tracer));
+	} catch(const tracer_exception&) {
+		// Do not let a diverged tracee go on for real.
+		kill(child_tracer.process_id(), SIGKILL);
+		throw;
+	}
+	errout << "+++ replayed " + std::to_string(replayer.events_replayed()) + " system calls, passed through "
+	          + std::to_string(replayer.events_passed_through()) + (replayer.finished() ? "" : ", log not finished") + " +++\n";
+	return (WIFEXITED(child_tracer.status()) ? WEXITSTATUS(child_tracer.status()) : 1);
+}
+
+int main(int argc, char **argv) {
+	const bool recording = (argc >= 2 && std::string(argv[1]) == "-w");
+	const int first_command_arg = (recording ? 3 : 2);
+	if(argc < first_command_arg + 1) {
+		errout << "Usage: " + std::string(argc >= 1 ? argv[0] : "replay") + " [-w] trace.log command\n";
+		exit(1);
+	}
+	try {
+		const char *log_path = argv[first_command_arg - 1];
+		char **command_argv = &argv[first_command_arg];
+		return (recording ? record(log_path, command_argv) : replay(log_path, command_argv));
+	} catch(const tracer_exception& e) {
+		errout << std::string("Tracer exception: \n") + e.what() + "\n";
+		exit(1);
+	}
+}
@@ -1,196 +1,177 @@
 #include <iostream>       // std::cout
-#include <sstream>        // std::ostringstream
-#include <sys/syscall.h>  // syscall numbers
+#include <iomanip>        // std::setw, std::setprecision
+#include <algorithm>      // std::min, std::sort
+#include <cctype>         // isprint
+#include <cstring>        // strnlen, strerror
+#include <vector>
+#include <fcntl.h>        // AT_FDCWD
+#include <ctime>          // struct timespec
 #include "pretty_printing.hpp"
 
-std::ostream& pretty_print::out = std::cerr;
-
-/**
- * @brief Returns the documented number of arguments for the given system call.
- * Incomplete, just for demonstration purposes. 
- */
-int pretty_print::get_syscall_n_arguments(long syscall_number) {
-	int n_args = tracer::n_syscall_arguments;
-	switch(syscall_number) {
-		case __NR_brk:
-		case __NR_close:
-		case __NR_exit:
-		case __NR_exit_group:
-			n_args = 1;
-			break;
-		case __NR_read:
-		case __NR_write:
-#ifdef __NR_open
-		case __NR_open:
-#endif
-#ifdef __NR_access
-		case __NR_access:
-#endif
-#ifdef __NR_stat
-		case __NR_stat:
-#endif
-		case __NR_fstat:
-		case __NR_mprotect:
-		case __NR_execve:
-			n_args = 3;
-			break;
-		case __NR_openat:
-		case __NR_faccessat:
-#ifdef __NR_fstatat
-		case __NR_fstatat:
-#endif
-#ifdef __NR_newfstatat
-		case __NR_newfstatat:
-#endif
-			n_args = 4;
-			break;
-		case __NR_execveat:
-			n_args = 5;
-			break;
-		case __NR_mmap:
-			n_args = 6;
-			break;
-	}
-	return n_args;
-}
-
+std::ostringstream pretty_print::out;
 
 /**
  * @brief Prints a strace-like half-line about the called system call (name) and
- * its arguments. The real strace uses its knowledge of system call arguments,
- * interprets them and prints more meaningful information. Since this is only
- * intended as an example use of the tracer, we only implement this for a small
- * subset of arguments.
+ * its arguments, decoded according to the system call's signature in the
+ * table the tracer generates at build time. The real strace knows much more
+ * about each argument (flag names, struct contents); since this is only
+ * intended as an example use of the tracer, we decode strings, buffers and
+ * a few structs, and print everything else as numbers or pointers.
  */
+long pretty_print::arguments[6] = {};
+
 void pretty_print::print_syscall_entry(tracer &child_tracer, long syscall_number) {
-	long n_args = get_syscall_n_arguments(syscall_number);
-	out << child_tracer.get_syscall_name() << "(";
-	if(n_args > 0) {
-		print_syscall_argument_1(child_tracer);
-	}
-	if(n_args > 1) {
-		out << ", ";
-		print_syscall_argument_2(child_tracer);
+	const struct syscall_signature& signature = tracer::syscall_signature_by_number(syscall_number);
+	for(int i = 0; i < signature.n_arguments; i++) {
+		arguments[i] = child_tracer.get_syscall_argument(i);
 	}
-	if(n_args > 2) {
-		out << ", ";
-		print_syscall_argument_3(child_tracer);
-	}
-	if(n_args > 3) {
-		out << ", ";
-		print_syscall_argument_4(child_tracer);
-	}
-	// We skip special treatment of the rest of the arguments for brevity
-	for(int i = 4; i < n_args; i++) {
-		out << ", ";
-		print_default(child_tracer.get_syscall_argument(i));
+	out << child_tracer.get_syscall_name() << "(";
+	for(int i = 0; i < signature.n_arguments; i++) {
+		if(i > 0) {
+			out << ", ";
+		}
+		print_syscall_argument(child_tracer, signature.arguments[i], arguments, i);
 	}
 	out << ")";
 }
 
-void pretty_print::print_syscall_argument_1(tracer& child_tracer) {
-	long syscall_number = child_tracer.get_syscall_number();
-	long argument_1 = child_tracer.get_syscall_argument(0);
-	switch(syscall_number) {
-#ifdef __NR_open
-		case __NR_open:
-#endif
-#ifdef __NR_access
-		case __NR_access:
-#endif
-#ifdef __NR_stat
-		case __NR_stat:
-#endif
-#ifdef __NR_fstatat
-		case __NR_fstatat:
-#endif
-		case __NR_execve:
-			print_string_pointer(child_tracer, argument_1);
+void pretty_print::print_syscall_argument(tracer &child_tracer, const struct syscall_argument_signature& signature,
+                                          const long arguments[], int i) {
+	const long argument = arguments[i];
+	switch(signature.kind) {
+		case ARGUMENT_FD:
+			// Declared int in the kernel; the upper half of the register is junk.
+			if((int)argument == AT_FDCWD) {
+				out << "AT_FDCWD";
+			} else {
+				print_default((int)argument);
+			}
 			break;
-		case __NR_mmap:
-		case __NR_mprotect:
-		case __NR_brk:
-			print_pointer(argument_1);
+		case ARGUMENT_PID:
+		case ARGUMENT_SIGNAL:
+			print_default((int)argument);
 			break;
-		default:
-			print_default(argument_1);
-			break;
-	}
-}
-
-void pretty_print::print_syscall_argument_2(tracer& child_tracer) {
-	long syscall_number = child_tracer.get_syscall_number();
-	long argument_2 = child_tracer.get_syscall_argument(1);
-	switch(syscall_number) {
-		case __NR_execveat:
-		case __NR_openat:
-		case __NR_newfstatat:
-		case __NR_faccessat:
-			print_string_pointer(child_tracer, argument_2);
+		case ARGUMENT_POINTER:
+		case ARGUMENT_BUFFER_OUT:  // Only filled in by the time the call returns
+		case ARGUMENT_STRUCT_OUT:
+		case ARGUMENT_INT_OUT:     // Printed after the return value
+		case ARGUMENT_SOCKLEN_INOUT:
+			print_pointer(argument);
 			break;
-		case __NR_read:
-		case __NR_write:
-			print_string_pointer(child_tracer, argument_2, child_tracer.get_syscall_argument(2));
+		case ARGUMENT_STRING:
+			print_string_pointer(child_tracer, argument);
 			break;
-		case __NR_execve:
-#ifdef __NR_stat
-		case __NR_stat:
-#endif
-#ifdef __NR_fstat
-		case __NR_fstat:
-#endif
-#ifdef __NR_lstat
-		case __NR_lstat:
-#endif
-			print_pointer(argument_2);
+		case ARGUMENT_STRING_ARRAY:
+			print_string_array(child_tracer, argument);
 			break;
-		default:
-			print_default(argument_2);
+		case ARGUMENT_BUFFER_IN:
+			print_buffer_pointer(child_tracer, argument, arguments[signature.length_argument]);
 			break;
-	}
-}
-
-void pretty_print::print_syscall_argument_3(tracer& child_tracer) {
-	long syscall_number = child_tracer.get_syscall_number();
-	long argument_3 = child_tracer.get_syscall_argument(2);
-	switch(syscall_number) {
-		case __NR_execveat:
-			print_pointer(argument_3);
+		case ARGUMENT_FLAGS:
+			out << "0x" << std::hex << argument << std::dec;
 			break;
-		default:
-			print_default(argument_3);
+		case ARGUMENT_MODE:
+			out << (argument == 0 ? "" : "0") << std::oct << argument << std::dec;
 			break;
-	}
-}
-
-void pretty_print::print_syscall_argument_4(tracer& child_tracer) {
-	long syscall_number = child_tracer.get_syscall_number();
-	long argument_4 = child_tracer.get_syscall_argument(3);
-	switch(syscall_number) {
-		case __NR_execveat:
-			print_pointer(argument_4);
+		case ARGUMENT_STRUCT_IN:
+		case ARGUMENT_STRUCT_INOUT:
+			if(signature.struct_type == SYSCALL_STRUCT_TIMESPEC && signature.length_argument < 0) {
+				print_timespec_pointer(child_tracer, argument);
+			} else {
+				print_pointer(argument);
+			}
 			break;
 		default:
-			print_default(argument_4);
+			print_default(argument);
 			break;
 	}
 }
 
 void pretty_print::print_syscall_exit(tracer &child_tracer, long syscall_number) {
 	out << " = ";
-	long return_value = child_tracer.get_syscall_return_value();
-	switch(syscall_number) {
-		case __NR_brk:
-		case __NR_mmap:
-			print_pointer(return_value);
+	const long return_value = child_tracer.get_syscall_return_value();
+	const bool failed = (return_value < 0 && return_value >= -4095);
+	const struct syscall_signature& signature = tracer::syscall_signature_by_number(syscall_number);
+	switch(signature.return_kind) {
+		case RETURN_POINTER:
+			if(failed) {
+				print_default(return_value);
+			} else {
+				print_pointer(return_value);
+			}
+			break;
+		case RETURN_NONE:
+			if(failed) {
+				print_default(return_value);
+			} else {
+				out << "?";
+			}
 			break;
 		default:
 			print_default(return_value);
 			break;
 	}
+	if(!failed) {
+		for(int i = 0; i < signature.n_arguments; i++) {
+			if(signature.arguments[i].kind == ARGUMENT_INT_OUT && arguments[i] != 0) {
+				out << " ";
+				print_int_array_pointer(child_tracer, arguments[i], signature.arguments[i].count);
+			}
+		}
+	}
 	out << "\n";
 }
 
+/**
+ * @brief Prints a table like `strace -c` does: per system call, its share
+ * of the total time, the time, calls and errors, and latency percentiles
+ * from the histogram, followed by the errno of every failed system call.
+ */
+void pretty_print::print_summary(const syscall_statistics& statistics) {
+	std::vector<std::pair<long, struct syscall_totals>> rows;
+	struct syscall_totals sum = {};
+	for(long number : statistics.syscalls()) {
+		rows.emplace_back(number, statistics.totals(number));
+		sum.calls += rows.back().second.calls;
+		sum.errors += rows.back().second.errors;
+		sum.total_time += rows.back().second.total_time;
+	}
+	std::sort(rows.begin(), rows.end(), [](const std::pair<long, struct syscall_totals>& a,
+	                                       const std::pair<long, struct syscall_totals>& b) {
+		return a.second.total_time > b.second.total_time;
+	});
+	const char *rule = "------ ----------- ----------- --------- --------- ---------- ---------- ----------------\n";
+	out << "% time     seconds  usecs/call     calls    errors    p50 (us)   p99 (us) syscall\n" << rule;
+	out << std::fixed;
+	for(const auto& row : rows) {
+		const struct syscall_totals& totals = row.second;
+		out << std::setw(6) << std::setprecision(2) << (sum.total_time == 0 ? 0.0 : 100.0 * totals.total_time / sum.total_time)
+		    << " " << std::setw(11) << std::setprecision(6) << totals.total_time / 1e9
+		    << " " << std::setw(11) << (totals.returns == 0 ? 0 : totals.total_time / 1000 / totals.returns)
+		    << " " << std::setw(9) << totals.calls
+		    << " " << std::setw(9) << (totals.errors == 0 ? std::string() : std::to_string(totals.errors))
+		    << " " << std::setw(10) << std::setprecision(3) << syscall_statistics::latency_quantile(totals, 0.5) / 1e3
+		    << " " << std::setw(10) << syscall_statistics::latency_quantile(totals, 0.99) / 1e3
+		    << " " << tracer::syscall_name_by_number(row.first) << "\n";
+	}
+	out << rule;
+	out << std::setw(6) << std::setprecision(2) << 100.0
+	    << " " << std::setw(11) << std::setprecision(6) << sum.total_time / 1e9
+	    << " " << std::setw(11) << ""
+	    << " " << std::setw(9) << sum.calls
+	    << " " << std::setw(9) << sum.errors
+	    << " " << std::setw(10) << ""
+	    << " " << std::setw(10) << ""
+	    << " total\n";
+	out.unsetf(std::ios_base::floatfield);
+	for(const auto& row : rows) {
+		for(const struct syscall_errno_count& errno_count : row.second.errors_by_errno) {
+			out << tracer::syscall_name_by_number(row.first) << ": " << std::dec << errno_count.count
+			    << " x " << strerror(errno_count.error) << " (" << errno_count.error << ")\n";
+		}
+	}
+}
+
 void pretty_print::print_default(long arg) {
 	out << std::dec << arg;
 }
@@ -203,39 +184,140 @@ void pretty_print::print_pointer(long arg) {
 	}
 }
 
+void pretty_print::print_escaped(const std::string& contents) {
+	static const char hex_digits[] = "0123456789abcdef";
+	out << '"';
+	for(unsigned char c : contents) {
+		switch(c) {
+			case '\n':
+				out << "\\n";
+				break;
+			case '\t':
+				out << "\\t";
+				break;
+			case '"':
+			case '\\':
+				out << '\\' << c;
+				break;
+			default:
+				if(isprint(c)) {
+					out << c;
+				} else {
+					out << "\\x" << hex_digits[c >> 4] << hex_digits[c & 0xf];
+				}
+				break;
+		}
+	}
+	out << '"';
+}
+
+void pretty_print::print_timespec_pointer(tracer& child_tracer, long arg) {
+	struct timespec value;
+	if(arg == 0) {
+		out << "NULL";
+	} else if(child_tracer.read_memory((void *)arg, &value, sizeof(value)) != sizeof(value)) {
+		print_pointer(arg);
+	} else {
+		out << std::dec << "{tv_sec=" << value.tv_sec << ", tv_nsec=" << value.tv_nsec << "}";
+	}
+}
+
+void pretty_print::print_int_array_pointer(tracer& child_tracer, long arg, size_t count) {
+	std::vector<int> values(count);
+	if(child_tracer.read_memory((void *)arg, values.data(), count * sizeof(int)) != count * sizeof(int)) {
+		print_pointer(arg);
+		return;
+	}
+	out << "[";
+	for(size_t i = 0; i < count; i++) {
+		out << (i > 0 ? ", " : "") << values[i];
+	}
+	out << "]";
+}
+
 void pretty_print::print_string_pointer(tracer& child_tracer, long arg, size_t max_length) {
 	if(arg == 0) {
 		out << "NULL";
 	} else {
-		std::ostringstream temp_out;
+		bool terminated = false;
+		std::string contents;
 		try {
-			temp_out << '"';
-			char read_word[4] = {};
-			bool cut_off = true;
-			for(size_t i = 0; i < max_length; i++) {
-				*(long *)read_word = child_tracer.read_word((void *)(arg + i*4));
-				int j = 0;
-				for(; j < 4 && read_word[j] != 0; j++) {
-					temp_out << read_word[j];
-				}
-				if(read_word[j] == 0) {
-					// Reached NULL terminator
-					cut_off = false;
-					break;
-				}
-			}
-			if(cut_off) {
-				temp_out << "...";
-			}
-			temp_out << '"';
+			contents = child_tracer.read_string((void *)arg, max_length, &terminated);
 		} catch(const tracer_exception& e) {
 			// If we cannot read memory successfully, just print the pointer address.
 			out << "0x" << std::hex << arg;
 			return;
 		}
-		// Only print to stdout if reading memory did not fail
-		out << temp_out.str();
+		print_escaped(contents);
+		out << (terminated ? "" : "...");
+	}
+}
+
+void pretty_print::print_buffer_pointer(tracer& child_tracer, long arg, size_t length, size_t max_length) {
+	if(arg == 0) {
+		out << "NULL";
+	} else {
+		std::string contents(std::min(length, max_length), '\0');
+		size_t read = child_tracer.read_memory((void *)arg, &contents[0], contents.size());
+		if(read == 0 && length > 0) {
+			out << "0x" << std::hex << arg;
+			return;
+		}
+		contents.resize(read);
+		print_escaped(contents);
+		out << (read < length ? "..." : "");
+	}
+}
+
+void pretty_print::print_string_array(tracer& child_tracer, long arg, size_t max_elements, size_t max_length) {
+	if(arg == 0) {
+		out << "NULL";
+		return;
+	}
+	std::vector<long> pointers(max_elements + 1);
+	size_t n_pointers = child_tracer.read_memory((void *)arg, pointers.data(), pointers.size() * sizeof(long)) / sizeof(long);
+	size_t count = 0;
+	while(count < n_pointers && pointers[count] != 0) {
+		count++;
+	}
+	if(count == n_pointers && count <= max_elements) {
+		// Could not read up to the terminating NULL.
+		print_pointer(arg);
+		return;
+	}
+	count = std::min(count, max_elements);
+	/* Most strings are short; fetch all of them in one batch, and only go
+	   back for those that could not be read in full. */
+	std::vector<std::string> strings(count, std::string(max_length, '\0'));
+	std::vector<struct memory_region> regions(count);
+	for(size_t i = 0; i < count; i++) {
+		regions[i] = { (void *)pointers[i], &strings[i][0], max_length, false };
+	}
+	child_tracer.read_memory_batch(regions);
+	out << "[";
+	for(size_t i = 0; i < count; i++) {
+		if(i > 0) {
+			out << ", ";
+		}
+		bool terminated = false;
+		if(regions[i].success) {
+			strings[i].resize(strnlen(&strings[i][0], max_length));
+			terminated = strings[i].size() < max_length;
+		} else {
+			try {
+				strings[i] = child_tracer.read_string((void *)pointers[i], max_length, &terminated);
+			} catch(const tracer_exception& e) {
+				print_pointer(pointers[i]);
+				continue;
+			}
+		}
+		print_escaped(strings[i]);
+		out << (terminated ? "" : "...");
+	}
+	if(pointers[count] != 0) {
+		out << ", ...";
 	}
+	out << "]";
 }
 
 void pretty_print::print_string_pointer_pointer(tracer& child_tracer, long arg, size_t max_length) {
@@ -1,43 +1,51 @@
 #pragma once
-#include <iostream> // std::ostream
+#include <sstream>  // std::ostringstream
 #include "tracer.hpp"
+#include "syscall_statistics.hpp"
 
 /**
  * @brief Pretty printing functionality for system call names and arguments.
  * 
- * We wrap this in a class to easily be able to swap out the output stream
- * (if we want to print to stdout instead of stderr, for example).
+ * Everything is formatted into `out`, which the caller hands on to be
+ * written; strace does the writing on a separate thread, so that the tracee
+ * does not wait on stderr.
  * 
  * This is only a small subset of the functionality of the real `strace`; we
- * show how, for a couple of common system calls, we can use the tracer
- * architecture to read system call names, numbers and arguments, as well as
- * memory, and format it meaningfully based on system call argument type 
- * documentation.
+ * show how we can use the tracer architecture to read system call names,
+ * numbers and arguments, as well as memory, and format it meaningfully based
+ * on the system call signature table generated at build time.
  */
 struct pretty_print {
 
-	static std::ostream& out;  // strace prints to stderr by default
+	static std::ostringstream out;  // Formatted text not handed on yet
 
-	static int get_syscall_n_arguments(long syscall_number);
+	static long arguments[6];  // Of the last system call entry printed; some registers are reused at exit
 
 	static void print_syscall_entry(tracer &child_tracer, long syscall_number);
 
 	static void print_syscall_exit(tracer &child_tracer, long syscall_number);
 
-	static void print_syscall_argument_1(tracer &child_tracer);
+	static void print_syscall_argument(tracer &child_tracer, const struct syscall_argument_signature& signature,
+	                                   const long arguments[], int i);
 
-	static void print_syscall_argument_2(tracer &child_tracer);
-
-	static void print_syscall_argument_3(tracer &child_tracer);
-
-	static void print_syscall_argument_4(tracer &child_tracer);
+	static void print_summary(const syscall_statistics& statistics);
 
 	static void print_default(long arg);
 
 	static void print_pointer(long arg);
 
+	static void print_timespec_pointer(tracer &child_tracer, long arg);
+
+	static void print_escaped(const std::string& contents);
+
+	static void print_int_array_pointer(tracer &child_tracer, long arg, size_t count);
+
 	static void print_string_pointer(tracer &child_tracer, long arg, size_t max_length = 32);
 
+	static void print_buffer_pointer(tracer &child_tracer, long arg, size_t length, size_t max_length = 32);
+
+	static void print_string_array(tracer &child_tracer, long arg, size_t max_elements = 32, size_t max_length = 32);
+
 	static void print_string_pointer_pointer(tracer &child_tracer, long arg, size_t max_length = 32);
 
 };
\ No newline at end of file
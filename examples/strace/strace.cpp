@@ -6,29 +6,71 @@
 #include <errno.h>   // errno
 #include <string.h>  // strerror
 #include <sys/syscall.h>  // syscall numbers
+#include <sys/wait.h>     // WIFEXITED, WEXITSTATUS
+#include <cstring>        // strncmp, strchr
+#include <memory>         // std::unique_ptr
+#include <vector>
+#include <atomic>
+#include <chrono>             // std::chrono::milliseconds
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "tracer.hpp"
+#include "trace_log.hpp"
+#include "syscall_statistics.hpp"
 #include "pretty_printing.hpp"
+#include "spsc_ring.hpp"
 
 char **command_argv = NULL;
+std::vector<long> traced_syscalls;  // empty if all system calls are traced
+std::unique_ptr<trace_log_writer> trace_log;  // set if recording with -w instead of printing
+std::unique_ptr<syscall_statistics> statistics;  // set if summarizing with -c instead of printing
 tracer child_tracer;
 bool called_exit_group = false;
 long exit_code = 0;
-std::ostream& out = std::cerr; // strace prints to stderr
 std::ostream& errout = std::cerr;
 
+/* Lines are formatted while the tracee is stopped, since that needs its
+   memory, but written to stderr by `writer`, so that a slow terminal or
+   pipe does not keep the tracee stopped. Nothing may be lost, so a full
+   ring blocks the tracer. */
+spsc_ring<std::string> lines(4096, SPSC_BLOCK);
+std::thread writer;
+std::atomic<bool> tracing_done(false);
+std::mutex lines_mutex;
+std::condition_variable lines_available;  // Lets the writer sleep while the ring is empty
+std::atomic<bool> writer_waiting(false);
+
+void write_lines();
+
+void publish();
+
+void finish_writing();
+
 void parse_args(int argc, char **argv);
 
 void exec_command(char **command_argv);
 
+void parse_syscall_list(const char *list);
+
 int main(int argc, char **argv) {
 	parse_args(argc, argv);
+	/* When tracing only some system calls, a seccomp filter lets all
+	   others run without stopping the tracee. */
+	const bool filtered = !traced_syscalls.empty();
+	const enum stop_reason syscall_stop = (filtered ? stop_reason::SECCOMP : stop_reason::SYSCALL_ENTRY);
 	try {
-		if(child_tracer.fork() == 0) {
+		if((filtered ? child_tracer.fork(traced_syscalls) : child_tracer.fork()) == 0) {
 			exec_command(command_argv);
 		}
+		writer = std::thread(write_lines);
 		while(1) {
-			if(!child_tracer.resume_and_wait(stop_reason::SYSCALL_ENTRY)) {
-				errout << "Program exited without calling exit()\n";
+			if(!child_tracer.resume_and_wait(syscall_stop)) {
+				if(filtered && WIFEXITED(child_tracer.status())) {
+					pretty_print::out << "+++ exited with " + std::to_string(WEXITSTATUS(child_tracer.status())) + " +++\n";
+				} else {
+					pretty_print::out << "Program exited without calling exit()\n";
+				}
 				break;
 			}
 			long syscall_number = child_tracer.get_syscall_number();
@@ -36,34 +78,139 @@ int main(int argc, char **argv) {
 				called_exit_group = true;
 				exit_code = child_tracer.get_syscall_argument(0);
 			}
-			pretty_print::print_syscall_entry(child_tracer, syscall_number);
+			if(trace_log) {
+				trace_log->syscall_entry(child_tracer);
+			} else if(statistics) {
+				statistics->syscall_entry(child_tracer);
+			} else {
+				pretty_print::print_syscall_entry(child_tracer, syscall_number);
+				publish();
+			}
 			if(!child_tracer.resume_and_wait(stop_reason::SYSCALL_EXIT)) {
 				if(called_exit_group) {
-					out << " = ?\n+++ exited with " + std::to_string(exit_code) + " +++\n";
+					pretty_print::out << (trace_log || statistics ? "" : " = ?\n") + std::string("+++ exited with ") + std::to_string(exit_code) + " +++\n";
 					break;
 				}
-				errout << "Program exited unexpectedly before completing system call.\n";
+				pretty_print::out << "Program exited unexpectedly before completing system call.\n";
 				break;
 			}
-			pretty_print::print_syscall_exit(child_tracer, syscall_number);
+			if(trace_log) {
+				trace_log->syscall_exit(child_tracer);
+			} else if(statistics) {
+				statistics->syscall_exit(child_tracer);
+			} else {
+				pretty_print::print_syscall_exit(child_tracer, syscall_number);
+				publish();
+			}
 		}
+		publish();
+		if(trace_log) {
+			trace_log->close();
+		}
+		if(statistics) {
+			pretty_print::print_summary(*statistics);
+			publish();
+		}
+		finish_writing();
 	} catch(const tracer_exception& e) {
+		publish();
+		finish_writing();
 		errout << std::string("Tracer exception: \n") + e.what();
 		exit(1);
 	}
 	return 0;
 }
 
+void write_lines() {
+	std::string line;
+	while(1) {
+		while(lines.try_pop(line)) {
+			errout << line;
+		}
+		if(tracing_done) {
+			// The tracer may have published right before finishing.
+			while(lines.try_pop(line)) {
+				errout << line;
+			}
+			break;
+		}
+		std::unique_lock<std::mutex> lock(lines_mutex);
+		writer_waiting = true;
+		if(lines.size() == 0 && !tracing_done) {
+			// Bounded, in case a line was published just before we started waiting.
+			lines_available.wait_for(lock, std::chrono::milliseconds(1));
+		}
+		writer_waiting = false;
+	}
+}
+
+void publish() {
+	const std::string text = pretty_print::out.str();
+	if(text.empty()) {
+		return;
+	}
+	pretty_print::out.str(std::string());
+	lines.push(text);
+	if(writer_waiting) {
+		std::lock_guard<std::mutex> lock(lines_mutex);
+		lines_available.notify_one();
+	}
+}
+
+void finish_writing() {
+	if(writer.joinable()) {
+		tracing_done = true;
+		{
+			std::lock_guard<std::mutex> lock(lines_mutex);
+			lines_available.notify_one();
+		}
+		writer.join();
+	}
+}
+
 void parse_args(int argc, char **argv) {
-	if(argc < 2) {
+	int first_command_arg = 1;
+	while(argc >= first_command_arg + 2) {
+		const std::string option = argv[first_command_arg];
+		if(option == "-c") {
+			statistics.reset(new syscall_statistics());
+			first_command_arg += 1;
+			continue;
+		} else if(option == "-e") {
+			parse_syscall_list(argv[first_command_arg + 1]);
+		} else if(option == "-w") {
+			trace_log.reset(new trace_log_writer(argv[first_command_arg + 1]));
+		} else {
+			break;
+		}
+		first_command_arg += 2;
+	}
+	if(argc < first_command_arg + 1) {
 		std::string name = "./tracer/install/bin/strace";
-		if(argc == 1) {
+		if(argc >= 1) {
 			name = std::string(argv[0]);
 		}
-		errout << "Usage: " + std::string(name) + " command\n";
+		errout << "Usage: " + std::string(name) + " [-c] [-e trace=name,...] [-w trace.log] command\n";
 		exit(1);
 	}
-	command_argv = &argv[1];
+	command_argv = &argv[first_command_arg];
+}
+
+void parse_syscall_list(const char *list) {
+	if(strncmp(list, "trace=", 6) == 0) {
+		list += 6;
+	}
+	while(*list != '\0') {
+		const char *end = strchr(list, ',');
+		const size_t length = (end == NULL ? strlen(list) : end - list);
+		const long number = tracer::syscall_number_by_name(list, length);
+		if(number == -1) {
+			errout << "Unknown system call: " + std::string(list, length) + "\n";
+			exit(1);
+		}
+		traced_syscalls.push_back(number);
+		list += length + (end == NULL ? 0 : 1);
+	}
 }
 
 void exec_command(char **command_argv) {
@@ -0,0 +1,189 @@
+#pragma once
+#include <cstddef>          // size_t
+#include <cstdint>          // uint64_t
+#include <atomic>
+#include <thread>           // std::this_thread::yield
+#include <vector>
+
+/**
+ * @brief What `spsc_ring::push` does when the ring is full.
+ */
+enum spsc_overflow_policy {
+	SPSC_BLOCK,  // Wait until the consumer makes room; the producer stalls
+	SPSC_DROP,   // Discard the new value; only counted in the statistics
+	SPSC_COUNT,  // Discard the new value, and tell the consumer how many were lost with the next value it pops
+};
+
+/**
+ * @brief Counters of a `spsc_ring`. Each is written by one side only, so a
+ * snapshot taken from a third thread may be slightly out of date.
+ */
+struct spsc_ring_statistics {
+	uint64_t pushed;        // Values accepted into the ring
+	uint64_t popped;        // Values taken out of the ring
+	uint64_t dropped;       // Values discarded under SPSC_DROP or SPSC_COUNT
+	uint64_t blocked;       // Pushes that found the ring full under SPSC_BLOCK
+	size_t high_watermark;  // Most values in the ring at once, as seen by the producer
+};
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer thread and one
+ * consumer thread. The capacity is rounded up to a power of two.
+ */
+template<typename T>
+class spsc_ring {
+private:
+
+	struct slot {
+		T value;
+		uint64_t lost_before;  // Values discarded right before this one, under SPSC_COUNT
+	};
+
+	std::vector<struct slot> _slots;
+	const size_t _mask;
+	const enum spsc_overflow_policy _policy;
+
+	/* Each index is written by one side only; keep them on separate cache
+	   lines, together with that side's counters. Padding rather than
+	   alignas, since C++11 cannot allocate over-aligned types with new. */
+	char _padding_head[64];
+	std::atomic<size_t> _head;  // Next slot to pop, and values popped; written by the consumer
+	char _padding_tail[64 - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> _tail;  // Next slot to push, and values pushed; written by the producer
+	std::atomic<uint64_t> _dropped;
+	std::atomic<uint64_t> _blocked;
+	std::atomic<size_t> _high_watermark;
+	uint64_t _lost = 0;         // Discarded since the last accepted value; producer only
+	char _padding_end[64];
+
+	static size_t _round_up(size_t capacity) {
+		size_t rounded = 1;
+		while(rounded < capacity) {
+			rounded <<= 1;
+		}
+		return rounded;
+	}
+
+	// Single writer: a plain load and store is enough.
+	static inline void _increment(std::atomic<uint64_t>& counter) {
+		counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	inline void _store(size_t tail, size_t head, const T& value) {
+		struct slot& slot = _slots[tail & _mask];
+		slot.value = value;
+		slot.lost_before = _lost;
+		_lost = 0;
+		_tail.store(tail + 1, std::memory_order_release);
+		if(tail + 1 - head > _high_watermark.load(std::memory_order_relaxed)) {
+			_high_watermark.store(tail + 1 - head, std::memory_order_relaxed);
+		}
+	}
+
+public:
+
+	explicit spsc_ring(size_t capacity, enum spsc_overflow_policy policy=SPSC_BLOCK)
+		: _slots(_round_up(capacity)), _mask(_round_up(capacity) - 1), _policy(policy),
+		  _head(0), _tail(0), _dropped(0), _blocked(0), _high_watermark(0)
+	{
+	}
+
+	spsc_ring(const spsc_ring&) = delete;
+	spsc_ring& operator=(const spsc_ring&) = delete;
+
+	/**
+	 * @brief Append `value`; returns false without blocking if the ring is
+	 * full, regardless of the overflow policy and without counting it.
+	 * Producer only.
+	 */
+	bool try_push(const T& value) {
+		const size_t tail = _tail.load(std::memory_order_relaxed);
+		const size_t head = _head.load(std::memory_order_acquire);
+		if(tail - head == _slots.size()) {
+			return false;
+		}
+		_store(tail, head, value);
+		return true;
+	}
+
+	/**
+	 * @brief Append `value`, applying the ring's overflow policy if it is
+	 * full. Under SPSC_BLOCK, `on_full()` is called repeatedly until there
+	 * is room. Returns false if the value was discarded. Producer only.
+	 */
+	template<typename function>
+	bool push(const T& value, function on_full) {
+		const size_t tail = _tail.load(std::memory_order_relaxed);
+		size_t head = _head.load(std::memory_order_acquire);
+		if(tail - head == _slots.size()) {
+			if(_policy != SPSC_BLOCK) {
+				_increment(_dropped);
+				if(_policy == SPSC_COUNT) {
+					_lost++;
+				}
+				return false;
+			}
+			_increment(_blocked);
+			do {
+				on_full();
+				head = _head.load(std::memory_order_acquire);
+			} while(tail - head == _slots.size());
+		}
+		_store(tail, head, value);
+		return true;
+	}
+
+	inline bool push(const T& value) {
+		return push(value, []() { std::this_thread::yield(); });
+	};
+
+	/**
+	 * @brief Remove the oldest value into `value`; returns false without
+	 * blocking if the ring is empty. Consumer only.
+	 */
+	inline bool try_pop(T& value) {
+		uint64_t lost_before = 0;
+		return try_pop(value, lost_before);
+	}
+
+	/**
+	 * @brief Like `try_pop`, and also set `lost_before` to the number of
+	 * values discarded under SPSC_COUNT right before this one. Values
+	 * discarded after the last one pushed are only in the statistics.
+	 */
+	bool try_pop(T& value, uint64_t& lost_before) {
+		const size_t head = _head.load(std::memory_order_relaxed);
+		if(head == _tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		const struct slot& slot = _slots[head & _mask];
+		value = slot.value;
+		lost_before = slot.lost_before;
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	inline size_t capacity() const { return _slots.size(); };
+
+	inline enum spsc_overflow_policy policy() const { return _policy; };
+
+	/**
+	 * @brief Number of values in the ring; exact only when called from the
+	 * producer or consumer with the other side idle.
+	 */
+	inline size_t size() const { return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire); };
+
+	/**
+	 * @brief Snapshot of the ring's counters; may be called from any thread.
+	 */
+	struct spsc_ring_statistics statistics() const {
+		struct spsc_ring_statistics statistics;
+		statistics.pushed = _tail.load(std::memory_order_relaxed);
+		statistics.popped = _head.load(std::memory_order_relaxed);
+		statistics.dropped = _dropped.load(std::memory_order_relaxed);
+		statistics.blocked = _blocked.load(std::memory_order_relaxed);
+		statistics.high_watermark = _high_watermark.load(std::memory_order_relaxed);
+		return statistics;
+	}
+
+};
@@ -19,6 +19,9 @@ enum stop_reason {
 	SYSCALL_EXIT,   // The kernel is about to transfer control back to the tracee after a system call
 	SIGNALED,       // Tracer intercepted a signal to be sent to tracee
 	STEPPED,        // Tracee executed a single instruction
+	SECCOMP,        // The tracee is about to enter a system call selected by the tracer's seccomp filter
+	EMULATED_SYSCALL, // The tracee entered a system call that the kernel will skip (PTRACE_SYSEMU)
+	INTERRUPTED,    // A seized tracee stopped for PTRACE_INTERRUPT, a group-stop, or as a new child (PTRACE_EVENT_STOP)
 	NOT_STOPPED,    // The tracee is currently running
 };
 
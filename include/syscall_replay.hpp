@@ -0,0 +1,111 @@
+#pragma once
+#include <sys/types.h>      // pid_t
+#include <cstdint>          // uint64_t
+#include <vector>
+#include "tracer.hpp"
+#include "trace_log.hpp"
+
+/**
+ * @brief Replays the system calls one thread made during recording into a
+ * tracee running the same program, without the kernel executing them: the
+ * recorded return values and captured memory are handed back instead, so
+ * that files, sockets and clocks are read as they were recorded.
+ *
+ * Record with a `trace_log_writer`, calling `capture_outputs` at each exit
+ * before `syscall_exit`, and with `set_capture_mapped_files` if the mapped
+ * files may differ at replay. Replay through `PTRACE_SYSEMU`:
+ *
+ *     trace_log_reader log("trace.log");
+ *     syscall_replayer replayer(log);
+ *     if(tracee.fork() == 0) {
+ *         personality(ADDR_NO_RANDOMIZE);
+ *         execvp(...);
+ *     }
+ *     replayer.install(tracee);
+ *     while(tracee.resume_and_wait(EMULATED_SYSCALL)
+ *           && replayer.syscall_passthrough(tracee));
+ *
+ * Replayed calls are answered by a `syscall_handler` in a single stop.
+ * System calls that manage the tracee itself rather than talk to the
+ * outside world (memory mappings, signal handling, exit, execve, ...) are
+ * passed through to the kernel; they surface as `EMULATED_SYSCALL` stops
+ * for `syscall_passthrough`. Files mapped with mmap are mapped anonymously
+ * and filled with the recorded contents, if these were recorded. Events
+ * whose captures were truncated cannot be replayed.
+ *
+ * The tracee must make the same system calls in the same order as during
+ * recording, and get the same addresses from mmap and brk, which needs
+ * address space randomization off in both runs, as above. Otherwise the
+ * replay diverges, and throws. Signals, threads and children are not
+ * replayed; a recorded thread's children each need their own replayer.
+ */
+class syscall_replayer {
+private:
+
+	trace_log_reader::iterator _next;  // Next event of `_recorded_thread`
+
+	trace_log_reader::iterator _end;
+
+	pid_t _recorded_thread;
+
+	std::vector<bool> _passthrough;  // By system call number
+
+	uint64_t _events_replayed = 0;
+
+	uint64_t _events_passed_through = 0;
+
+	void _skip_other_threads();
+
+	const struct syscall_event& _expect(long number);
+
+	void _write_captures(tracer& tracee, const struct syscall_event& event);
+
+	long _replay(tracer& tracee, long number);
+
+public:
+
+	/**
+	 * @brief Replay the events of thread `recorded_thread` from `log`, or
+	 * of the thread of the first event if -1. The log must outlive the
+	 * replayer.
+	 */
+	explicit syscall_replayer(const trace_log_reader& log, pid_t recorded_thread=-1);
+
+	/**
+	 * @brief Have system call `number` executed by the kernel rather than
+	 * replayed, or not. Takes effect at the next `install`.
+	 */
+	void set_passthrough(long number, bool enabled);
+	bool passthrough(long number) const;
+
+	/**
+	 * @brief Register a `syscall_handler` with `tracee` for every system
+	 * call that is not passed through. `tracee` must then be resumed with
+	 * `EMULATED_SYSCALL`.
+	 */
+	void install(tracer& tracee);
+
+	/**
+	 * @brief Remove the handlers of `install`.
+	 */
+	void uninstall(tracer& tracee);
+
+	/**
+	 * @brief At an `EMULATED_SYSCALL` stop, have the kernel execute the
+	 * system call after all, and check its result against the log. Leaves
+	 * the tracee at the `SYSCALL_EXIT` stop of the call, with a process ID
+	 * returned, e.g. by clone, replaced with the recorded one. Returns
+	 * false if the tracee exited meanwhile, e.g. in exit_group.
+	 */
+	bool syscall_passthrough(tracer& tracee);
+
+	/**
+	 * @brief Whether all events of the recorded thread have been replayed.
+	 */
+	inline bool finished() const { return _next == _end; };
+
+	inline pid_t recorded_thread() const { return _recorded_thread; };
+	inline uint64_t events_replayed() const { return _events_replayed; };
+	inline uint64_t events_passed_through() const { return _events_passed_through; };
+
+};
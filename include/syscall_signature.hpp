@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>          // size_t
+#include <cstdint>          // int8_t, uint8_t
+
+/**
+ * @brief What a system call argument means, as far as decoding it goes.
+ */
+enum syscall_argument_kind : uint8_t {
+	ARGUMENT_INT,           // Plain integer
+	ARGUMENT_FD,            // File descriptor, or AT_FDCWD for directory descriptors
+	ARGUMENT_POINTER,       // Address, or pointer to something not decoded
+	ARGUMENT_STRING,        // NUL-terminated string read by the kernel
+	ARGUMENT_STRING_ARRAY,  // NULL-terminated array of strings, e.g. argv
+	ARGUMENT_BUFFER_IN,     // Buffer read by the kernel, its length in argument `length_argument`
+	ARGUMENT_BUFFER_OUT,    // Buffer written by the kernel, its capacity in argument `length_argument`
+	ARGUMENT_FLAGS,         // Bit flags
+	ARGUMENT_MODE,          // File mode bits
+	ARGUMENT_SIZE,          // Size or count
+	ARGUMENT_PID,           // Process, thread or process group id
+	ARGUMENT_SIGNAL,        // Signal number
+	ARGUMENT_STRUCT_IN,     // Pointer to a `struct_type` read by the kernel
+	ARGUMENT_STRUCT_OUT,    // Pointer to a `struct_type` written by the kernel
+	ARGUMENT_STRUCT_INOUT,  // Pointer to a `struct_type` read and written back by the kernel, e.g. pollfds
+	ARGUMENT_INT_OUT,       // Pointer to `count` ints written by the kernel, e.g. the fds of pipe
+	ARGUMENT_SOCKLEN_INOUT, // Pointer to a socklen_t: a buffer capacity in, the length of its contents out
+};
+
+/**
+ * @brief What a system call returns on success. Failures are always a
+ * negated errno.
+ */
+enum syscall_return_kind : uint8_t {
+	RETURN_INT,
+	RETURN_FD,
+	RETURN_SIZE,
+	RETURN_POINTER,
+	RETURN_PID,
+	RETURN_NONE,  // Does not return on success, e.g. execve or exit
+};
+
+/**
+ * @brief Structures passed to system calls. Names follow the spelling in
+ * build_scripts/syscall_signatures.txt, which the table generator checks
+ * against this list.
+ */
+enum syscall_struct_type : uint8_t {
+	SYSCALL_STRUCT_NONE,
+	SYSCALL_STRUCT_STAT,
+	SYSCALL_STRUCT_STATX,
+	SYSCALL_STRUCT_STATFS,
+	SYSCALL_STRUCT_USTAT,
+	SYSCALL_STRUCT_TIMESPEC,
+	SYSCALL_STRUCT_TIMEVAL,
+	SYSCALL_STRUCT_TIMEZONE,
+	SYSCALL_STRUCT_ITIMERSPEC,
+	SYSCALL_STRUCT_ITIMERVAL,
+	SYSCALL_STRUCT_TIMEX,
+	SYSCALL_STRUCT_UTIMBUF,
+	SYSCALL_STRUCT_TMS,
+	SYSCALL_STRUCT_RLIMIT,
+	SYSCALL_STRUCT_RUSAGE,
+	SYSCALL_STRUCT_SYSINFO,
+	SYSCALL_STRUCT_UTSNAME,
+	SYSCALL_STRUCT_SIGACTION,
+	SYSCALL_STRUCT_SIGSET,
+	SYSCALL_STRUCT_SIGINFO,
+	SYSCALL_STRUCT_SIGEVENT,
+	SYSCALL_STRUCT_STACK,
+	SYSCALL_STRUCT_POLLFD,
+	SYSCALL_STRUCT_FD_SET,
+	SYSCALL_STRUCT_EPOLL_EVENT,
+	SYSCALL_STRUCT_IOVEC,
+	SYSCALL_STRUCT_SOCKADDR,
+	SYSCALL_STRUCT_MSGHDR,
+	SYSCALL_STRUCT_MMSGHDR,
+	SYSCALL_STRUCT_SEMBUF,
+	SYSCALL_STRUCT_MSQID_DS,
+	SYSCALL_STRUCT_SHMID_DS,
+	SYSCALL_STRUCT_MQ_ATTR,
+	SYSCALL_STRUCT_SCHED_PARAM,
+	SYSCALL_STRUCT_SCHED_ATTR,
+	SYSCALL_STRUCT_CAP_HEADER,
+	SYSCALL_STRUCT_CAP_DATA,
+	SYSCALL_STRUCT_USER_DESC,
+	SYSCALL_STRUCT_IO_EVENT,
+	SYSCALL_STRUCT_IOCB,
+	SYSCALL_STRUCT_IO_URING_PARAMS,
+	SYSCALL_STRUCT_ROBUST_LIST,
+	SYSCALL_STRUCT_FUTEX_WAITV,
+	SYSCALL_STRUCT_RSEQ,
+	SYSCALL_STRUCT_PERF_EVENT_ATTR,
+	SYSCALL_STRUCT_FILE_HANDLE,
+	SYSCALL_STRUCT_CLONE_ARGS,
+	SYSCALL_STRUCT_OPEN_HOW,
+	SYSCALL_STRUCT_MOUNT_ATTR,
+	SYSCALL_STRUCT_LANDLOCK_RULESET_ATTR,
+};
+
+/**
+ * @brief Size in bytes of one `type` as the kernel reads or writes it on
+ * the calling architecture, or 0 if it varies between calls (e.g.
+ * sched_attr, which carries its own size).
+ */
+size_t syscall_struct_size(enum syscall_struct_type type);
+
+struct syscall_argument_signature {
+	enum syscall_argument_kind kind;
+	/* For buffers, the argument holding their length; for structs, the
+	   argument holding the number of elements if it is an array (for
+	   sockaddr, the length in bytes; for fd_set, the number of
+	   descriptors). -1 otherwise. If that argument is an
+	   `ARGUMENT_SOCKLEN_INOUT`, the length is the socklen_t it points to. */
+	int8_t length_argument;
+	enum syscall_struct_type struct_type;
+	uint8_t count;  // For `ARGUMENT_INT_OUT`, the number of ints; 0 otherwise
+};
+
+/**
+ * @brief How to decode the arguments and return value of a system call.
+ * One entry per system call number lives in a dense table generated at
+ * build time from build_scripts/syscall_signatures.txt; see
+ * `tracer::syscall_signature_by_number`.
+ */
+struct syscall_signature {
+	bool known;        // False if the system call is missing from the specification
+	int8_t n_arguments;
+	enum syscall_return_kind return_kind;
+	struct syscall_argument_signature arguments[6];  // Linux system calls take at most six
+};
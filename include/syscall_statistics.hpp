@@ -0,0 +1,129 @@
+#pragma once
+#include <sys/types.h>      // pid_t
+#include <cstdint>          // uint64_t
+#include <memory>           // std::unique_ptr
+#include <unordered_map>
+#include <vector>
+#include "tracer.hpp"
+
+/**
+ * @brief Number of buckets of a `syscall_totals` latency histogram. Bucket
+ * 0 counts calls that took 0 ns, bucket i > 0 those that took
+ * [2^(i-1), 2^i) ns, and the last bucket everything from 2^(n-2) ns on.
+ */
+static const int syscall_latency_buckets = 36;
+
+struct syscall_errno_count {
+	int error;       // Positive errno, e.g. ENOENT
+	uint64_t count;
+};
+
+/**
+ * @brief What a `syscall_statistics` knows about one system call.
+ */
+struct syscall_totals {
+	uint64_t calls;       // Entries observed
+	uint64_t returns;     // Exits observed; only these are timed
+	uint64_t errors;      // Exits with a return value in -4095..-1
+	uint64_t total_time;  // Sum over returns of the time from entry to exit stop, in ns
+	uint64_t max_time;
+	uint64_t latency_histogram[syscall_latency_buckets];
+	std::vector<struct syscall_errno_count> errors_by_errno;  // In order of first occurrence
+};
+
+/**
+ * @brief Aggregates system calls per traced process: how often each was
+ * called, how often it failed and with which errno, and how long it took,
+ * as a histogram with logarithmic buckets.
+ *
+ * Call `syscall_entry` at each `SYSCALL_ENTRY` (or `SECCOMP`) stop and
+ * `syscall_exit` at the matching `SYSCALL_EXIT` stop. The time of a call is
+ * taken from CLOCK_MONOTONIC at the two stops, so it includes the cost of
+ * stopping the tracee. Recording a call costs two clock reads, three hash
+ * lookups and a few increments; it allocates only when a thread, process,
+ * system call or errno is seen for the first time, and formats nothing.
+ *
+ * Not thread-safe; use one per thread that handles stops, e.g. one per
+ * `tracer_pool` worker, and `merge` them afterwards.
+ */
+class syscall_statistics {
+private:
+
+	struct process {
+		std::vector<std::unique_ptr<struct syscall_totals>> syscalls;  // By system call number
+	};
+
+	struct in_flight {
+		struct syscall_totals *totals;  // NULL if the thread is not in a recorded system call
+		uint64_t entry_time;
+	};
+
+	std::unordered_map<pid_t, struct process> _processes;  // By thread group id
+
+	std::unordered_map<pid_t, struct in_flight> _in_flight;  // By thread id
+
+	struct syscall_totals& _totals(pid_t process, long number);
+
+public:
+
+	/**
+	 * @brief Count the system call `tracee` is entering, and start timing it.
+	 * Calls with numbers the tracer does not know are ignored.
+	 */
+	void syscall_entry(tracer& tracee);
+
+	/**
+	 * @brief Time the system call `tracee` is returning from, and count its
+	 * error if it failed.
+	 */
+	void syscall_exit(tracer& tracee);
+
+	/**
+	 * @brief Stop timing the current system call of thread `thread`, e.g.
+	 * once it has exited in the middle of `exit_group`.
+	 */
+	void forget(pid_t thread);
+
+	/**
+	 * @brief Add all counts of `other` to this.
+	 */
+	void merge(const syscall_statistics& other);
+
+	void clear();
+
+	/**
+	 * @brief Thread group ids of all processes seen.
+	 */
+	std::vector<pid_t> processes() const;
+
+	/**
+	 * @brief Numbers of all system calls seen, in any process, ascending.
+	 */
+	std::vector<long> syscalls() const;
+
+	/**
+	 * @brief Totals of system call `number` in process `process`, or NULL
+	 * if it was never called there.
+	 */
+	const struct syscall_totals *totals(pid_t process, long number) const;
+
+	/**
+	 * @brief Totals of system call `number` summed over all processes.
+	 */
+	struct syscall_totals totals(long number) const;
+
+	/**
+	 * @brief Smallest latency in ns below which a fraction `quantile` of
+	 * the returns of `totals` fall, rounded up to its histogram bucket.
+	 */
+	static uint64_t latency_quantile(const struct syscall_totals& totals, double quantile);
+
+	static int latency_bucket(uint64_t nanoseconds);
+
+	/**
+	 * @brief Exclusive upper bound of histogram bucket `bucket` in ns; that
+	 * of the last bucket is UINT64_MAX.
+	 */
+	static uint64_t latency_bucket_end(int bucket);
+
+};
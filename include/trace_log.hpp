@@ -0,0 +1,292 @@
+#pragma once
+#include <sys/types.h>      // pid_t
+#include <cstddef>          // size_t
+#include <cstdint>          // uint32_t, uint64_t
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "tracer.hpp"
+
+/* A trace log is a `trace_log_header` followed by `syscall_event` records,
+   each directly followed by its `syscall_event_capture`s. All records and
+   captures start at multiples of 8 bytes, in the byte order of the
+   recording machine, so that a mapped log can be read in place. */
+
+/**
+ * @brief Linux system calls take at most six arguments.
+ */
+static const int syscall_event_max_arguments = 6;
+
+/**
+ * @brief `syscall_event_capture::argument` of memory found through the
+ * return value rather than an argument, e.g. a file mapped by mmap.
+ */
+static const uint32_t syscall_event_return_value = syscall_event_max_arguments;
+
+struct trace_log_header {
+	char magic[8];                // "TRACELOG"
+	uint32_t version;
+	uint32_t audit_architecture;  // AUDIT_ARCH_* of the recorded tracees
+	uint64_t realtime_offset;     // CLOCK_REALTIME - CLOCK_MONOTONIC at creation, in ns
+};
+
+/**
+ * @brief Contents of tracee memory captured with a `syscall_event`.
+ */
+struct syscall_event_capture {
+	uint32_t argument;  // Index of the system call argument it was found through, or `syscall_event_return_value`
+	uint32_t length;    // Bytes of data
+	uint64_t address;   // Tracee address of the data
+
+	inline const char *data() const { return (const char *)(this + 1); };
+
+	/**
+	 * @brief The capture following this one; only valid if this is not
+	 * the last capture of its event.
+	 */
+	inline const struct syscall_event_capture *next() const {
+		return (const struct syscall_event_capture *)(data() + ((length + 7) & ~(size_t)7));
+	};
+};
+
+enum syscall_event_flags {
+	SYSCALL_EVENT_RETURNED = 1,  // The exit was observed; `return_value` and `exit_time` are set
+	SYSCALL_EVENT_TRUNCATED = 2, // Captures were cut short or left out to stay within the writer's limit
+};
+
+/**
+ * @brief One system call of one thread, from its entry to its exit.
+ */
+struct syscall_event {
+	uint32_t size;          // Of the record, including captures
+	uint16_t n_captures;
+	uint16_t flags;         // enum syscall_event_flags
+	int32_t process_id;     // Thread group id
+	int32_t thread_id;
+	int64_t syscall_number;
+	int64_t arguments[syscall_event_max_arguments];
+	int64_t return_value;
+	uint64_t entry_time;    // CLOCK_MONOTONIC, in ns
+	uint64_t exit_time;
+
+	/**
+	 * @brief The first of `n_captures` captures; use
+	 * `syscall_event_capture::next` for the others.
+	 */
+	inline const struct syscall_event_capture *captures() const { return (const struct syscall_event_capture *)(this + 1); };
+};
+
+/**
+ * @brief Default limit of `trace_log_writer::set_max_captures_length`.
+ */
+static const size_t trace_log_default_max_captures_length = 64 << 20;
+
+/**
+ * @brief Appends system calls of tracees to a trace log file.
+ *
+ * Records are collected in a buffer that is written out whenever it is
+ * full, so recording mostly costs a copy. Call `syscall_entry` at each
+ * `SYSCALL_ENTRY` (or `SECCOMP`) stop and `syscall_exit` at the matching
+ * `SYSCALL_EXIT` stop; the exit writes the event. In between, `capture`
+ * adds memory a pointer argument refers to, e.g. the path of an `open`
+ * at entry, or the data of a `read` at exit. Events whose exit is never
+ * observed, e.g. of `exit_group`, are written without a return value when
+ * the thread enters its next system call or the writer is closed.
+ *
+ * The captures of one event are limited to `max_captures_length` bytes,
+ * including their headers; what does not fit is cut off or left out,
+ * and the event is flagged `SYSCALL_EVENT_TRUNCATED`.
+ */
+class trace_log_writer {
+private:
+
+	struct pending_event {
+		struct syscall_event event;
+		std::vector<char> captures;  // Capture headers and padded data
+		uint16_t n_captures;
+		uint32_t socklen_capacities[syscall_event_max_arguments];  // At entry, of `ARGUMENT_SOCKLEN_INOUT` arguments
+	};
+
+	int _fd = -1;
+
+	std::vector<char> _buffer;
+
+	size_t _buffered = 0;
+
+	uint64_t _events_written = 0;
+
+	size_t _max_captures_length = trace_log_default_max_captures_length;
+
+	bool _capture_mapped_files = false;
+
+	std::unordered_map<pid_t, struct pending_event> _pending;  // By thread id
+
+	void _append(const void *data, size_t length);
+
+	void _write_out(const char *data, size_t length);
+
+	void _write_pending(struct pending_event& pending);
+
+public:
+
+	/**
+	 * @brief Create (or truncate) the log at `path`, buffering up to
+	 * `buffer_size` bytes between writes.
+	 */
+	trace_log_writer(const std::string& path, size_t buffer_size=1 << 20);
+
+	trace_log_writer(const trace_log_writer&) = delete;
+	trace_log_writer& operator=(const trace_log_writer&) = delete;
+
+	/**
+	 * @brief Calls `close`.
+	 */
+	~trace_log_writer();
+
+	/**
+	 * @brief Start an event for the system call `tracee` is entering.
+	 */
+	void syscall_entry(tracer& tracee);
+
+	/**
+	 * @brief Add `length` bytes of tracee memory at the address in
+	 * argument `argument` to the current event of `tracee`. Memory that
+	 * cannot be read is captured up to the first unreadable byte, and
+	 * captures beyond `max_captures_length` are cut off.
+	 */
+	void capture(tracer& tracee, int argument, size_t length);
+
+	/**
+	 * @brief Like `capture`, but for memory at `address` that was found
+	 * through argument `argument` (or `syscall_event_return_value`)
+	 * rather than at the address it holds, e.g. a buffer of an iovec.
+	 */
+	void capture(tracer& tracee, int argument, uint64_t address, size_t length);
+
+	/**
+	 * @brief At a `SYSCALL_EXIT` stop, capture what the kernel wrote into
+	 * tracee memory for the current system call of `tracee`, as far as its
+	 * signature tells: output buffers and structures, limited to what the
+	 * return value or a socklen_t says was filled, structures the kernel
+	 * writes back such as pollfds and fd_sets, output ints such as the fds
+	 * of pipe, the buffers of readv, preadv and preadv2, and, if enabled
+	 * with `set_capture_mapped_files`, the contents of files mapped with
+	 * mmap. This is what a `syscall_replayer` writes back. Failed calls
+	 * capture nothing, and data written through pointers nested in
+	 * structures, e.g. by recvmsg or ioctl, is not found.
+	 */
+	void capture_outputs(tracer& tracee);
+
+	/**
+	 * @brief Have `capture_outputs` capture the whole contents of every
+	 * file mapped with mmap, or not (the default). Every program start
+	 * maps ld.so and its libraries, so this adds megabytes per process;
+	 * it is only needed to replay a program whose mapped files are not
+	 * there or have changed.
+	 */
+	inline void set_capture_mapped_files(bool enabled) { _capture_mapped_files = enabled; };
+	inline bool capture_mapped_files() const { return _capture_mapped_files; };
+
+	/**
+	 * @brief Limit the captures of each event to `length` bytes, including
+	 * their headers. At most `UINT32_MAX - sizeof(struct syscall_event)`.
+	 */
+	void set_max_captures_length(size_t length);
+	inline size_t max_captures_length() const { return _max_captures_length; };
+
+	/**
+	 * @brief Complete the current event of `tracee` with its return value
+	 * and append it to the log.
+	 */
+	void syscall_exit(tracer& tracee);
+
+	/**
+	 * @brief Append a complete event, followed by `n_captures` captures
+	 * from `captures`: packed headers, each followed by its data padded
+	 * to 8 bytes. `event.size` and `event.n_captures` are filled in.
+	 * Throws if the record would not fit its 32-bit size.
+	 */
+	void write(const struct syscall_event& event, const char *captures=NULL, size_t captures_length=0, uint16_t n_captures=0);
+
+	/**
+	 * @brief Write out buffered events.
+	 */
+	void flush();
+
+	/**
+	 * @brief Write out pending and buffered events and close the file.
+	 */
+	void close();
+
+	inline uint64_t events_written() const { return _events_written; };
+
+};
+
+/**
+ * @brief Maps a trace log and iterates its events in place, without
+ * copying or parsing:
+ *
+ *     trace_log_reader log("trace.log");
+ *     for(const struct syscall_event& event : log) {
+ *         ...
+ *     }
+ *
+ * A record cut off at the end of the file, as left by a recorder that did
+ * not close its log, ends the iteration.
+ */
+class trace_log_reader {
+private:
+
+	const char *_data = NULL;
+
+	size_t _length = 0;
+
+public:
+
+	class iterator {
+		friend class trace_log_reader;
+
+	private:
+
+		const char *_position;
+		const char *_end;
+
+		iterator(const char *position, const char *end) : _position(position), _end(end) {
+			_stop_if_incomplete();
+		}
+
+		inline void _stop_if_incomplete() {
+			const size_t left = _end - _position;
+			if(left < sizeof(struct syscall_event) || ((const struct syscall_event *)_position)->size > left
+			   || ((const struct syscall_event *)_position)->size < sizeof(struct syscall_event)) {
+				_position = _end;
+			}
+		};
+
+	public:
+
+		inline const struct syscall_event& operator*() const { return *(const struct syscall_event *)_position; };
+		inline const struct syscall_event *operator->() const { return (const struct syscall_event *)_position; };
+		inline iterator& operator++() {
+			_position += ((const struct syscall_event *)_position)->size;
+			_stop_if_incomplete();
+			return *this;
+		};
+		inline bool operator!=(const iterator& other) const { return _position != other._position; };
+		inline bool operator==(const iterator& other) const { return _position == other._position; };
+	};
+
+	explicit trace_log_reader(const std::string& path);
+
+	trace_log_reader(const trace_log_reader&) = delete;
+	trace_log_reader& operator=(const trace_log_reader&) = delete;
+
+	~trace_log_reader();
+
+	inline const struct trace_log_header& header() const { return *(const struct trace_log_header *)_data; };
+
+	iterator begin() const;
+
+	iterator end() const;
+
+};
@@ -2,9 +2,53 @@
 #include <sys/types.h>      // pid_t
 #include <sys/user.h>       // struct user_regs_struct
 #include <stdexcept>        // std::runtime_error
-#include <list>
+#include <cstdint>          // uintptr_t
+#include <memory>           // std::shared_ptr
+#include <functional>       // std::function
+#include <unordered_map>
+#include <vector>
 #include <unordered_set>
 #include "stop_reason.hpp"
+#include "syscall_signature.hpp"
+
+class tracer_session;
+class tracer_registry;
+
+/**
+ * @brief Names a tracer in a `tracer_registry`; see `tracer_registry::get`.
+ */
+struct tracer_handle {
+	uint32_t index;
+	uint32_t generation;
+};
+
+/**
+ * @brief Selects how `read_memory` and `write_memory` access tracee memory.
+ */
+enum memory_backend {
+	MEMORY_PTRACE,      // One PTRACE_PEEKDATA/POKEDATA per word
+	MEMORY_PROCESS_VM,  // process_vm_readv/writev, falling back to ptrace for unreachable pages
+	MEMORY_PROC_MEM,    // pread/pwrite on a persistent /proc/<pid>/mem file descriptor
+};
+
+/**
+ * @brief Selects where system call numbers, arguments and return values, as
+ * well as the instruction and stack pointer, are read from.
+ */
+enum syscall_info_backend {
+	SYSCALL_INFO_REGISTERS,  // Architecture-specific register reads
+	SYSCALL_INFO_PTRACE,     // One PTRACE_GET_SYSCALL_INFO per stop (Linux 5.3+)
+};
+
+/**
+ * @brief One range of tracee memory to be read by `read_memory_batch`.
+ */
+struct memory_region {
+	void *offset;       // Start of the range in the tracee
+	void *destination;  // Local buffer of at least `length` bytes
+	size_t length;
+	bool success;       // Set by `read_memory_batch` if all `length` bytes were read
+};
 
 #define tracer_ensure_invariants() do { \
 	if(tracee.process_id == -1) { \
@@ -13,33 +57,146 @@
 } while(0)
 
 class tracer {
+	friend class tracer_session;
+	friend class tracer_registry;
+
 private:
 
+	/* Closes the descriptor once the last tracer copy referring to it
+	   lets go of it. */
+	struct memory_file {
+		int fd;
+		memory_file(int fd) : fd(fd) {}
+		~memory_file();
+	};
+
+	/* The tracer's view of memory shared with the tracee; unmapped once
+	   the last tracer copy referring to it lets go of it. */
+	struct shared_mapping {
+		void *local;
+		void *remote;
+		size_t length;
+		shared_mapping(void *local, void *remote, size_t length) : local(local), remote(remote), length(length) {}
+		~shared_mapping();
+	};
+
 	struct tracee {
-		pid_t process_id = -1;
+		pid_t process_id = -1;  // Thread id, for tracees that are threads
+		pid_t thread_group_id = -1;
 		enum stop_reason stop_reason = NOT_STOPPED;
+		enum __ptrace_request last_request = PTRACE_CONT;
 		int status;
 		bool in_syscall = false;
+		bool seized = false;  // Attached with PTRACE_SEIZE, directly or through a seized parent
 		bool registers_valid = false;
+		bool registers_dirty = false;
 		struct user_regs_struct registers;
+		bool syscall_info_valid = false;
+		struct __ptrace_syscall_info syscall_info;
+		std::shared_ptr<struct memory_file> memory_file;
+		std::vector<char> memory_cache;
+		std::vector<uintptr_t> memory_cache_pages;
+		size_t memory_cache_next = 0;
+		std::shared_ptr<struct shared_mapping> shared_memory;
+	};
+
+	struct settings {
+		enum memory_backend memory_backend = MEMORY_PROCESS_VM;
+		size_t memory_cache_pages = 8;
+		bool trace_seccomp = false;
+		enum syscall_info_backend syscall_info_backend = SYSCALL_INFO_REGISTERS;
+		bool write_through_registers = false;
+		bool trace_children = false;
+		bool trace_threads = false;
+		std::unordered_map<long, std::function<long(tracer&, long, const long *)>> syscall_handlers;
 	};
 
 	struct tracee tracee;
 
-	std::list<tracer> _children;
+	struct settings _settings;
+
+	std::vector<tracer_handle> _children;
+
+	size_t _children_kept = 0;  // Size of `_children` after the last `_release_finished_children`
 
-	void _set_options(bool trace_children);
+	tracer_registry *_registry = NULL;  // Where our children live, and we, if we are one
+
+	std::shared_ptr<tracer_registry> _owned_registry;  // Set for roots outside a session
+
+	tracer_handle _handle = { UINT32_MAX, 0 };  // Our own slot in `_registry`, if any
+
+	tracer_session *_session = NULL;
+
+	long _ptrace_options() const;
+
+	void _set_options();
 
 	void _await_sigstop();
 
+	void _await_interrupt();
+
+	bool _seize(pid_t pid);
+
 	void _handle_fork();
 
+	void _release_finished_children();
+
+	void _handle_exec();
+
+	void _take_over_thread(pid_t former_thread_id);
+
+	enum stop_reason _wait(bool block);
+
+	enum stop_reason _handle_wait_status(int status);
+
+	void _reestablish_shared_memory(uintptr_t inherited, size_t length);
+
+	bool _resume_and_wait_keeping_signals(enum stop_reason until, std::vector<int>& signals);
+	void _reraise_signals(const std::vector<int>& signals);
+
+	void _rewind_syscall(long number);
+	void _resume(enum __ptrace_request request);
+	bool _emulate_syscall();
+
+	const struct __ptrace_syscall_info *_syscall_info();
+
+	long _read_syscall_number();
+	long _read_syscall_argument(size_t i);
+	long _read_syscall_return_value();
+	long _read_instruction_pointer();
+	long _read_stack_pointer();
+
 	static long _read_registers_internal(pid_t pid, struct user_regs_struct& destination);
 
 	static long _write_registers_internal(pid_t pid, const struct user_regs_struct& source);
 
-	static const long max_syscall_number;
-	static const char *syscall_names[];
+	size_t _read_memory_process_vm(void *offset, void *destination, size_t length);
+	size_t _write_memory_process_vm(void *offset, const void *source, size_t length);
+	size_t _read_memory_ptrace(void *offset, void *destination, size_t length);
+	size_t _write_memory_ptrace(void *offset, const void *source, size_t length);
+	size_t _read_memory_proc_mem(void *offset, void *destination, size_t length);
+	size_t _write_memory_proc_mem(void *offset, const void *source, size_t length);
+	int _memory_file_descriptor();
+	const char *_cached_page(uintptr_t page_address);
+	size_t _read_memory_cached(void *offset, void *destination, size_t length);
+	void _invalidate_memory_cache();
+
+	/**
+	 * @brief Index of the first NUL byte in `buffer`, or `length` if there
+	 * is none. Vectorized per architecture.
+	 */
+	static size_t _find_nul(const char *buffer, size_t length);
+
+	static const uint32_t _audit_architecture;
+
+	static void _install_seccomp_filter(const std::vector<long>& traced_syscalls);
+
+	static const long _max_syscall_number;
+	static const char *const syscall_names[];
+	static const size_t syscall_hash_size;
+	static const int32_t syscall_hash_seeds[];
+	static const int16_t syscall_hash_slots[];
+	static const struct syscall_signature syscall_signatures[];
 
 public:
 
@@ -53,6 +210,23 @@ public:
 	 */
 	static const int n_syscall_arguments;
 
+	/**
+	 * @brief Highest system call number on the calling architecture.
+	 */
+	static inline long max_syscall_number() { return _max_syscall_number; };
+
+	/**
+	 * @brief The AUDIT_ARCH_* value of the calling architecture, as seen
+	 * by seccomp filters and recorded in trace logs.
+	 */
+	static inline uint32_t audit_architecture() { return _audit_architecture; };
+
+	/**
+	 * @brief Length in bytes of the instruction that enters a system call
+	 * on the calling architecture.
+	 */
+	static const int syscall_instruction_length;
+
 	/**
 	 * @brief Fork execution into tracee and tracer, with tracee's pid = 0.
 	 * 
@@ -67,25 +241,171 @@ public:
 	 */
 	pid_t fork();
 
+	/**
+	 * @brief Like `fork()`, but only the given system calls will stop the
+	 * child, as `SECCOMP` stops. A seccomp filter selecting them is
+	 * installed in the child before this returns there, and is inherited
+	 * across `execve` and by the child's own children. All other system
+	 * calls run at full speed, as long as the tracee is resumed with
+	 * `resume(SECCOMP)`; resuming with `SYSCALL_ENTRY` or `SYSCALL_EXIT`
+	 * still stops at every system call.
+	 *
+	 * At a `SECCOMP` stop, the system call has not been executed yet;
+	 * `resume(SYSCALL_EXIT)` stops again once it completes.
+	 */
+	pid_t fork(const std::vector<long>& traced_syscalls);
+
 	/**
 	 * @brief Attach to a running process.
 	 */
 	void attach(pid_t pid);
 
 	/**
-	 * @brief Read-only access to a list of tracer objects for children 
-	 * forked by this tracer
+	 * @brief Attach to a running thread with `PTRACE_SEIZE`, then stop it
+	 * with `PTRACE_INTERRUPT` and wait for the resulting `INTERRUPTED`
+	 * stop. Unlike `attach`, no SIGSTOP is sent, so signals arriving
+	 * meanwhile need no re-injection and the tracee never sees a stray
+	 * stop signal. Children and threads traced from a seized tracee are
+	 * seized as well, and first stop with `INTERRUPTED`.
+	 */
+	void seize(pid_t pid);
+
+	/**
+	 * @brief Ask a running seized tracee to stop (`PTRACE_INTERRUPT`),
+	 * without waiting. A later `wait` reports the stop as `INTERRUPTED`,
+	 * unless another stop comes first and takes its place; e.g. a tracee
+	 * blocked in a system call while resumed for `SYSCALL_ENTRY` or
+	 * `SYSCALL_EXIT` leaves it with `SYSCALL_EXIT`, and the call is
+	 * restarted once resumed.
+	 */
+	void interrupt();
+
+	/**
+	 * @brief Stop tracing the tracee and let it continue normally. The
+	 * tracee must be stopped. Afterwards, this tracer is uninitialized and
+	 * may be used to `fork` or `attach` again.
+	 */
+	void detach();
+
+	/**
+	 * @brief Handles to the tracers of children forked by this tracee, in
+	 * the order they were forked. Resolve them with `child` or through
+	 * `registry()`; children of children are in the same registry.
+	 *
+	 * Outside a `tracer_session`, the tracers of children that have exited
+	 * or been detached stay valid until a later fork of this tracee
+	 * releases their slots and drops them from this list, which happens
+	 * whenever the list has doubled since; their own children are handed
+	 * to this tracer. In a session, the session releases them, and their
+	 * stale handles are dropped the same way.
+	 */
+	inline const std::vector<tracer_handle>& children() const { return _children; };
+
+	/**
+	 * @brief The tracer for one of `children()`, or NULL if it has been
+	 * released from the registry.
+	 */
+	tracer *child(tracer_handle handle) const;
+
+	/**
+	 * @brief The registry holding this tracer's children, or NULL if it
+	 * has not forked any yet and is not part of a registry itself.
+	 */
+	inline tracer_registry *registry() const { return _registry; };
+
+	/**
+	 * @brief This tracer's own slot in `registry()`; its index is
+	 * `UINT32_MAX` if it is not part of a registry.
 	 */
-	inline std::list<tracer> children() const { return _children; };
+	inline tracer_handle handle() const { return _handle; };
+
+	/**
+	 * @brief Automatically trace processes the tracee forks from now on
+	 * (`PTRACE_O_TRACEFORK`, `PTRACE_O_TRACEVFORK`). Each fork then stops
+	 * the tracee with `FORKED`, and a tracer for the new child, itself
+	 * stopped, is appended to `children()`. The `FORKED` stop is inside
+	 * the system call; resumed for system calls, the tracee next stops at
+	 * its `SYSCALL_EXIT`. If a tracee is attached, it must be stopped.
+	 */
+	void set_trace_children(bool enabled);
+	inline bool trace_children() const { return _settings.trace_children; };
+
+	/**
+	 * @brief Automatically trace threads the tracee creates from now on
+	 * (`PTRACE_O_TRACECLONE`). Like forked children, each new thread stops
+	 * the tracee with `FORKED` and gets its own tracer in `children()`,
+	 * with its own registers and system call state; its `thread_group_id`
+	 * tells it apart from a new process. Threads of a group share the
+	 * `/proc/<pid>/mem` descriptor and shared memory, but not cached
+	 * memory: memory written through one thread's tracer may still be
+	 * served from the cache of another thread's tracer until that thread
+	 * is resumed. If a tracee is attached, it must be stopped.
+	 *
+	 * When a thread other than the group leader calls `execve`, the kernel
+	 * gives it the leader's thread id; the leader's tracer continues
+	 * tracing it, and the thread's own tracer reports `EXITED`.
+	 */
+	void set_trace_threads(bool enabled);
+	inline bool trace_threads() const { return _settings.trace_threads; };
 
 	/**
 	 * @brief Read-only access to tracee information
 	 */
 	inline pid_t process_id() const { return tracee.process_id; };
+	inline pid_t thread_group_id() const { return tracee.thread_group_id; };
 	inline enum stop_reason stop_reason() const { return tracee.stop_reason; };
 	inline int status() const { return tracee.status; };
 	inline bool in_syscall() const { return tracee.in_syscall; };
 
+	/**
+	 * @brief Choose the mechanism `read_memory` and `write_memory` use.
+	 * Children spawned after this call inherit the setting.
+	 *
+	 * `MEMORY_PROC_MEM` keeps a `/proc/<pid>/mem` file descriptor open for
+	 * as long as the tracee lives; it is reopened transparently after an
+	 * `execve` in the tracee. Unlike `MEMORY_PROCESS_VM`, it can write to
+	 * read-only pages in a single call.
+	 */
+	inline void set_memory_backend(enum memory_backend backend) { _settings.memory_backend = backend; };
+	inline enum memory_backend memory_backend() const { return _settings.memory_backend; };
+
+	/**
+	 * @brief Set how many tracee pages `read_word` may keep cached while
+	 * the tracee is stopped; 0 disables the cache. Like the register
+	 * cache, cached pages are dropped when the tracee is resumed or any of
+	 * its memory is written through this tracer. The cache is not used
+	 * with the `MEMORY_PTRACE` backend, where filling a page costs more
+	 * than it saves.
+	 */
+	inline void set_memory_cache_pages(size_t pages) { _settings.memory_cache_pages = pages; _invalidate_memory_cache(); };
+	inline size_t memory_cache_pages() const { return _settings.memory_cache_pages; };
+
+	/**
+	 * @brief Choose where `get_syscall_number`, `get_syscall_argument`,
+	 * `get_syscall_return_value`, `get_instruction_pointer` and
+	 * `get_stack_pointer` get their values from.
+	 *
+	 * With `SYSCALL_INFO_PTRACE`, all of them are fetched with a single
+	 * `PTRACE_GET_SYSCALL_INFO` request at the first call after a stop,
+	 * and served from that until the tracee is resumed or its registers
+	 * are written. It also lets the kernel tell system call entry and exit
+	 * stops apart, rather than relying on `in_syscall` bookkeeping.
+	 * Values the kernel does not report at the current stop (e.g. the
+	 * return value at an entry) are still read from registers.
+	 */
+	inline void set_syscall_info_backend(enum syscall_info_backend backend) { _settings.syscall_info_backend = backend; };
+	inline enum syscall_info_backend syscall_info_backend() const { return _settings.syscall_info_backend; };
+
+	/**
+	 * @brief By default, `write_registers` and the `set_syscall_*`
+	 * functions only modify the cached registers, which are written to the
+	 * tracee once, by `flush`, before it is resumed or detached. With
+	 * write-through enabled, every register write reaches the tracee
+	 * immediately instead.
+	 */
+	inline void set_write_through_registers(bool enabled) { _settings.write_through_registers = enabled; if(enabled) { flush(); } };
+	inline bool write_through_registers() const { return _settings.write_through_registers; };
+
 	/**
 	 * @brief If tracee is stopped, continue its execution. Use `wait` to
 	 * await the next stop of the tracee.
@@ -106,9 +426,23 @@ public:
 	 * the return value, and potentially `resume/wait` in a loop until the
 	 * desired stop reason is observed. The `resume_and_wait` function can
 	 * do this for you.
+	 *
+	 * A successful `execve` in the tracee is not reported as a stop of
+	 * its own. The tracer always sets `PTRACE_O_TRACEEXEC`, to drop state
+	 * tied to the old address space, and resumes the tracee from within
+	 * `wait` the way it was resumed before. The kernel then does not send
+	 * the SIGTRAP a traced `execve` stops with otherwise, so there is no
+	 * `SIGNALED` stop for it either. When resumed for system calls, the
+	 * first stop in the new program is the `SYSCALL_EXIT` of `execve`.
 	 */
 	enum stop_reason wait();
 
+	/**
+	 * @brief Like `wait`, but return `NOT_STOPPED` right away if the
+	 * tracee has not stopped yet (`WNOHANG`).
+	 */
+	enum stop_reason try_wait();
+
 	/**
 	 * @brief Resume the tracee repeatedly until it stops for the given
 	 * stop_reason `until`, or until it exits. The return value can be used
@@ -132,17 +466,53 @@ public:
 	 * returned.
 	 */
 	const struct user_regs_struct& read_registers();
+
+	/**
+	 * @brief Replace the cached registers of the tracee. Unless
+	 * write-through is enabled, the tracee only sees the new values once
+	 * `flush` is called, which `resume` and `detach` do implicitly.
+	 */
 	void write_registers(const struct user_regs_struct& new_registers);
 
+	/**
+	 * @brief Write modified registers back to the tracee, if there are
+	 * any. This is a single `PTRACE_SETREGSET`, regardless of how many
+	 * registers were changed since the last stop.
+	 */
+	void flush();
+
 	/**
 	 * @brief Return the system call name for the given system call number.
 	 * If no system call with the given number is known, the default string
 	 * given is returned, which defaults to "unknown".
 	 * 
-	 * @param i 
-	 * @return long 
+	 * The names live in a table generated at build time; no memory is
+	 * allocated.
+	 */
+	static const char *syscall_name_by_number(long number, const char *default_name = "unknown");
+
+	/**
+	 * @brief Return the system call number for the given name on the
+	 * calling architecture, or -1 if there is no such system call. The
+	 * name need not be NUL-terminated; if it contains a NUL within
+	 * `length` bytes, there is no such system call.
+	 *
+	 * This is a lookup in a perfect hash table generated at build time;
+	 * it costs two hashes and one comparison, and allocates no memory.
 	 */
-	static std::string syscall_name_by_number(long number, std::string default_name = "unknown");
+	static long syscall_number_by_name(const char *name, size_t length);
+	static long syscall_number_by_name(const char *name);
+
+	/**
+	 * @brief Return how to decode the arguments and return value of system
+	 * call `number`. Numbers outside the table, and system calls missing
+	 * from build_scripts/syscall_signatures.txt, get a signature with
+	 * `known` false and six plain integer arguments.
+	 *
+	 * The signatures live in a dense table generated at build time; this
+	 * is an array lookup.
+	 */
+	static const struct syscall_signature& syscall_signature_by_number(long number);
 
 	/**
 	 * @brief Reads the architecture-specific register that contains the
@@ -159,9 +529,65 @@ public:
 	 * system call, if number=-1, or the system call of the given number.
 	 * 
 	 * @param number 
-	 * @return std::string 
+	 * @return const char *
+	 */
+	const char *get_syscall_name();
+
+	/**
+	 * @brief `syscall_signature_by_number` for the current system call.
+	 */
+	const struct syscall_signature& get_syscall_signature();
+
+	/**
+	 * @brief Execute system call `number` with the given arguments in the
+	 * tracee, and return its raw return value (a negated errno on failure).
+	 *
+	 * The tracee must be stopped at a system call entry. The injected call
+	 * replaces the one being entered; afterwards the tracee is rewound to
+	 * re-enter the original system call with its original registers, so
+	 * that it is at the same system call entry stop again on return.
+	 * Signals the tracee stops for in between are sent to it again, and
+	 * stop it at the next resume.
+	 */
+	long inject_syscall(long number, const std::vector<long>& arguments);
+
+	/**
+	 * @brief A function that emulates a system call in place of the
+	 * kernel. It receives the tracer, the system call number and its
+	 * `n_syscall_arguments` arguments, and returns the value the tracee
+	 * will see as the system call's result (a negated errno to signal an
+	 * error). It may read and write tracee memory and registers, but must
+	 * not resume the tracee.
+	 */
+	typedef std::function<long(tracer&, long number, const long *arguments)> syscall_handler;
+
+	/**
+	 * @brief Emulate system call `number` with `handler` whenever the tracee
+	 * is resumed with `EMULATED_SYSCALL`; an empty `handler` removes a
+	 * previously set one. Children spawned after this call inherit the
+	 * handlers.
+	 *
+	 * Resuming with `EMULATED_SYSCALL` uses `PTRACE_SYSEMU`: the tracee
+	 * stops once at every system call entry, and the kernel never executes
+	 * the call. Calls with a handler are answered and the tracee resumed
+	 * from within `wait`, without surfacing a stop; all other calls stop
+	 * with `EMULATED_SYSCALL`. At such a stop, either set a return value
+	 * and resume, or call `restart_syscall` to have the kernel execute the
+	 * call after all.
+	 */
+	void set_syscall_handler(long number, syscall_handler handler);
+
+	/**
+	 * @brief At an `EMULATED_SYSCALL` stop, rewind the tracee to re-issue
+	 * the system call it entered. `resume_and_wait(SYSCALL_ENTRY)` then
+	 * stops at a regular entry of the same call, which the kernel will
+	 * execute; a plain `resume/wait` first observes the `SYSCALL_EXIT` of
+	 * the skipped call.
 	 */
-	std::string get_syscall_name();
+	void restart_syscall();
+
+	long get_instruction_pointer();
+	long get_stack_pointer();
 
 	long get_syscall_argument(size_t i);
 	void set_syscall_argument(size_t i, long value);
@@ -170,6 +596,98 @@ public:
 	long read_word(void *offset);
 	void write_word(void *offset, long value);
 
+	/**
+	 * @brief Copy `length` bytes of tracee memory starting at `offset`
+	 * into `destination`.
+	 *
+	 * Whole ranges are transferred using `process_vm_readv`. Pages that
+	 * cannot be reached that way (e.g. mapped without read permission)
+	 * are read word-by-word through ptrace instead.
+	 *
+	 * @return The number of bytes copied. This is less than `length` only
+	 * if the tracee memory at `offset` plus the return value could not be
+	 * read by any means; all bytes before it have been copied.
+	 */
+	size_t read_memory(void *offset, void *destination, size_t length);
+
+	/**
+	 * @brief Copy `length` bytes from `source` into tracee memory starting
+	 * at `offset`.
+	 *
+	 * Whole ranges are transferred using `process_vm_writev`. Pages that
+	 * cannot be written that way (e.g. read-only text pages) are written
+	 * word-by-word through ptrace instead.
+	 *
+	 * @return The number of bytes written, with the same partial transfer
+	 * semantics as `read_memory`.
+	 */
+	size_t write_memory(void *offset, const void *source, size_t length);
+
+	/**
+	 * @brief Read a NUL-terminated string of at most `max_length` bytes
+	 * from tracee memory at `offset`. The terminator is not included in
+	 * the result.
+	 *
+	 * Memory is read a page at a time, never across a page boundary past
+	 * the terminator, so strings at the end of a mapping can be read.
+	 *
+	 * @param terminated If given, set to whether the terminator was found.
+	 * It is not if the string is longer than `max_length`, or if reading
+	 * stopped at unreadable memory.
+	 * @return The string. Throws if no memory at `offset` is readable.
+	 */
+	std::string read_string(void *offset, size_t max_length, bool *terminated = NULL);
+
+	/**
+	 * @brief Read many ranges of tracee memory at once, e.g. the targets
+	 * of an array of pointers.
+	 *
+	 * With the `MEMORY_PROCESS_VM` backend, consecutive regions are read
+	 * with as few `process_vm_readv` calls as possible. A region that
+	 * cannot be read that way is retried on its own through `read_memory`,
+	 * and the batch continues after it.
+	 *
+	 * @return The number of regions whose `success` flag was set.
+	 */
+	size_t read_memory_batch(struct memory_region *regions, size_t n_regions);
+	inline size_t read_memory_batch(std::vector<struct memory_region>& regions) {
+		return read_memory_batch(regions.data(), regions.size());
+	};
+
+	/**
+	 * @brief Map `length` bytes of memory shared between tracer and tracee,
+	 * so that buffers can be exchanged with plain memory copies. Returns
+	 * the tracer's address of the region; see `shared_memory_tracee_address`
+	 * for the tracee's.
+	 *
+	 * The tracee must be stopped at a system call entry; the region is set
+	 * up by injecting `memfd_create` and `mmap` into the tracee, with the
+	 * memory used for the region's name below the stack pointer restored
+	 * afterwards. Threads, vfork children and other children sharing the
+	 * address space share the region. Other children forked afterwards
+	 * get a region of their own, replacing the one inherited from the
+	 * parent, before their first stop is reported, whatever the tracee is
+	 * resumed with: the child is made to enter a harmless system call
+	 * right where it returns from the fork, and is left at its exit with
+	 * the registers it returned from the fork with. The region is torn
+	 * down when the tracee calls `execve`, exits, or is detached.
+	 *
+	 * Reads through `read_word` may be served from the page cache; access
+	 * the region through the returned pointer instead.
+	 */
+	void *map_shared_memory(size_t length);
+
+	/**
+	 * @brief Tear down the shared region. If the tracee is stopped at a
+	 * system call entry, it is unmapped in the tracee as well; otherwise
+	 * only the tracer's mapping is removed.
+	 */
+	void unmap_shared_memory();
+
+	inline void *shared_memory() const { return tracee.shared_memory ? tracee.shared_memory->local : NULL; };
+	inline void *shared_memory_tracee_address() const { return tracee.shared_memory ? tracee.shared_memory->remote : NULL; };
+	inline size_t shared_memory_length() const { return tracee.shared_memory ? tracee.shared_memory->length : 0; };
+
 };
 
 class tracer_exception : public std::runtime_error {
@@ -0,0 +1,186 @@
+#pragma once
+#if __cplusplus < 202002L
+#error "tracer_coroutine.hpp needs C++20 (-std=c++20); link with -ltracer_coroutine."
+#endif
+#include <sys/types.h>      // pid_t
+#include <coroutine>
+#include <cstdint>          // uint64_t
+#include <exception>        // std::exception_ptr
+#include <functional>       // std::function
+#include <unordered_map>
+#include "tracer.hpp"
+#include "tracer_session.hpp"
+
+class tracer_scheduler;
+
+/**
+ * @brief Coroutine tracing one tracee, run by a `tracer_scheduler`. It
+ * starts suspended, and the scheduler starts and owns it.
+ */
+class tracer_task {
+	friend class tracer_scheduler;
+
+public:
+
+	struct promise_type {
+		std::exception_ptr exception;
+		tracer_task get_return_object() {
+			return tracer_task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { exception = std::current_exception(); }
+	};
+
+	tracer_task() = default;
+
+	tracer_task(tracer_task&& other) noexcept : _coroutine(other._coroutine) {
+		other._coroutine = nullptr;
+	}
+
+	tracer_task& operator=(tracer_task&& other) noexcept {
+		if(this != &other) {
+			if(_coroutine) {
+				_coroutine.destroy();
+			}
+			_coroutine = other._coroutine;
+			other._coroutine = nullptr;
+		}
+		return *this;
+	}
+
+	tracer_task(const tracer_task&) = delete;
+	tracer_task& operator=(const tracer_task&) = delete;
+
+	~tracer_task() {
+		if(_coroutine) {
+			_coroutine.destroy();
+		}
+	}
+
+private:
+
+	std::coroutine_handle<promise_type> _coroutine;
+
+	explicit tracer_task(std::coroutine_handle<promise_type> coroutine) : _coroutine(coroutine) {}
+
+};
+
+/**
+ * @brief Runs one `tracer_task` per tracee of a `tracer_session` on the
+ * calling thread, so that per-tracee logic reads sequentially:
+ *
+ *     tracer_task trace(tracer_scheduler& scheduler, tracer& tracee) {
+ *         while(true) {
+ *             const bool stopped = co_await scheduler.next(tracee, SYSCALL_ENTRY);
+ *             if(!stopped) {
+ *                 break;
+ *             }
+ *             ...
+ *         }
+ *     }
+ *
+ *     tracer_scheduler scheduler(trace);
+ *     if(scheduler.fork() == 0) {
+ *         execvp(...);
+ *     }
+ *     scheduler.run();
+ *
+ * Every tracee that joins the session, whether through `fork`, `attach`,
+ * `seize_process` or by being forked by another tracee, gets a task from
+ * the scheduler's task factory once its first stop is handed out. `next`
+ * behaves like `tracer::resume_and_wait`: it resumes the tracee until it
+ * stops for `until` and yields true, or yields false once it exits.
+ * Intermediate stops are skipped without waking the task. A task should
+ * only await its own tracee. When a task returns while its tracee is
+ * stopped, the tracee is detached. An exception escaping a task is
+ * rethrown from `run`.
+ *
+ * Built separately from the C++11 library as `libtracer_coroutine`, with
+ * `make coroutine`.
+ */
+class tracer_scheduler {
+public:
+
+	typedef std::function<tracer_task(tracer_scheduler&, tracer&)> task_factory;
+
+	/**
+	 * @brief Awaitable returned by `next`.
+	 */
+	class stop_awaiter {
+		friend class tracer_scheduler;
+
+	private:
+
+		tracer_scheduler& _scheduler;
+		tracer& _tracer;
+		const enum stop_reason _until;
+
+		stop_awaiter(tracer_scheduler& scheduler, tracer& tracee, enum stop_reason until)
+			: _scheduler(scheduler), _tracer(tracee), _until(until) {}
+
+	public:
+
+		bool await_ready() const noexcept { return _tracer.stop_reason() == EXITED; }
+		void await_suspend(std::coroutine_handle<> waiting);
+		bool await_resume() const noexcept { return _tracer.stop_reason() == _until; }
+	};
+
+private:
+
+	struct tracee {
+		tracer_task task;
+		std::coroutine_handle<> waiting;  // Set while the task awaits a stop
+		enum stop_reason until = NOT_STOPPED;
+	};
+
+	tracer_session _session;
+
+	const task_factory _trace;
+
+	std::unordered_map<uint64_t, struct tracee> _tracees;  // By tracer handle
+
+	static uint64_t _key(const tracer& tracee);
+
+	void _step(tracer& target, struct tracee& state, std::coroutine_handle<> coroutine);
+
+public:
+
+	explicit tracer_scheduler(task_factory trace);
+
+	tracer_scheduler(const tracer_scheduler&) = delete;
+	tracer_scheduler& operator=(const tracer_scheduler&) = delete;
+
+	/**
+	 * @brief Fork a new tracee into the session, like `tracer_session::fork`.
+	 */
+	pid_t fork();
+
+	/**
+	 * @brief Attach to a running process, like `tracer_session::attach`.
+	 */
+	tracer& attach(pid_t pid);
+
+	/**
+	 * @brief Seize a process and its threads, like
+	 * `tracer_session::seize_process`.
+	 */
+	size_t seize_process(pid_t pid, bool descendants=false);
+
+	/**
+	 * @brief Resume `tracee` until it stops for `until`, suspending the
+	 * calling task meanwhile. Yields true for that stop, false if the
+	 * tracee exited first.
+	 */
+	inline stop_awaiter next(tracer& tracee, enum stop_reason until) { return stop_awaiter(*this, tracee, until); };
+
+	/**
+	 * @brief Hand out stops to tasks until all tracees have exited or been
+	 * detached.
+	 */
+	void run();
+
+	inline tracer_session& session() { return _session; };
+
+};
@@ -0,0 +1,146 @@
+#pragma once
+#include <sys/types.h>      // pid_t
+#include <sys/ptrace.h>     // PTRACE_*
+#include <sys/resource.h>   // struct rusage
+#include <sys/wait.h>       // waitpid, wait4
+#include <cstdint>          // uint64_t
+#include <atomic>
+#include "stop_reason.hpp"
+
+/**
+ * @brief What libtracer counts about its own work, when built with
+ * TRACER_COUNTERS defined (`make COUNTERS=1`).
+ */
+enum tracer_counter {
+	// ptrace requests, by type
+	COUNTER_PTRACE_RESUME,         // PTRACE_CONT, PTRACE_SYSCALL, PTRACE_SINGLESTEP, PTRACE_SYSEMU, ...
+	COUNTER_PTRACE_GET_REGISTERS,
+	COUNTER_PTRACE_SET_REGISTERS,
+	COUNTER_PTRACE_GET_SYSCALL_INFO,
+	COUNTER_PTRACE_PEEK,
+	COUNTER_PTRACE_POKE,
+	COUNTER_PTRACE_GET_EVENT_MESSAGE,
+	COUNTER_PTRACE_SET_OPTIONS,
+	COUNTER_PTRACE_ATTACH,         // PTRACE_TRACEME, PTRACE_ATTACH, PTRACE_SEIZE
+	COUNTER_PTRACE_INTERRUPT,
+	COUNTER_PTRACE_DETACH,
+	COUNTER_PTRACE_OTHER,
+	// Waiting
+	COUNTER_WAITS,                 // wait4 calls, including ones that found nothing
+	COUNTER_WAIT_INTERRUPTIONS,    // wait4 calls that returned EINTR
+	COUNTER_WAIT_TIME,             // ns spent in wait4
+	// Stops, by stop_reason
+	COUNTER_STOPS,
+	COUNTER_STOPS_LAST = COUNTER_STOPS + NOT_STOPPED - 1,
+	// Registers
+	COUNTER_REGISTER_READS_CACHED,  // read_registers served from the cache
+	COUNTER_REGISTER_READS,         // read_registers that asked the kernel
+	COUNTER_REGISTER_WRITES,        // Registers written to the kernel
+	// Tracee memory moved by read_memory, write_memory and the like
+	COUNTER_MEMORY_BYTES_READ,
+	COUNTER_MEMORY_BYTES_WRITTEN,
+	// Time
+	COUNTER_TRACEE_CPU_TIME,       // ns of user and system time of tracees, from wait4 rusage
+	N_TRACER_COUNTERS,
+};
+
+/**
+ * @brief A snapshot of all counters of all threads, see
+ * `tracer_counters_snapshot`.
+ */
+struct tracer_counters {
+	bool enabled;                 // False if libtracer was built without TRACER_COUNTERS; all else is 0
+	uint64_t counts[N_TRACER_COUNTERS];
+	uint64_t elapsed_time;        // ns of wall time since the counters were last reset
+	uint64_t tracer_cpu_time;     // ns of user and system time of this process since then
+
+	inline uint64_t operator[](enum tracer_counter counter) const { return counts[counter]; };
+
+	inline uint64_t stops(enum stop_reason reason) const { return counts[(int)COUNTER_STOPS + (int)reason]; };
+};
+
+/**
+ * @brief Sum of the counters of all threads of this process since the last
+ * `tracer_counters_reset`, or since the library was loaded.
+ */
+struct tracer_counters tracer_counters_snapshot();
+
+void tracer_counters_reset();
+
+/**
+ * @brief Name of `counter` for machine-readable output, e.g. "ptrace_peek"
+ * or "stops_syscall_entry".
+ */
+const char *tracer_counter_name(enum tracer_counter counter);
+
+/* Counting, for use inside libtracer only. Each thread counts into its own
+   block, so the hot path is a thread-local relaxed increment; snapshots sum
+   the blocks. Without TRACER_COUNTERS, all of it compiles to nothing. */
+
+#ifdef TRACER_COUNTERS
+
+struct tracer_counter_block {
+	std::atomic<uint64_t> counts[N_TRACER_COUNTERS];
+};
+
+struct tracer_counter_block& tracer_thread_counters();
+
+// Single writer: a plain load and store is enough.
+static inline void tracer_count(enum tracer_counter counter, uint64_t n=1) {
+	std::atomic<uint64_t>& count = tracer_thread_counters().counts[counter];
+	count.store(count.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static inline void tracer_count_ptrace(long request) {
+	enum tracer_counter counter = COUNTER_PTRACE_OTHER;
+	switch(request) {
+		case PTRACE_CONT: case PTRACE_SYSCALL: case PTRACE_SINGLESTEP:
+		case PTRACE_SYSEMU: case PTRACE_LISTEN:
+			counter = COUNTER_PTRACE_RESUME; break;
+		case PTRACE_GETREGSET: counter = COUNTER_PTRACE_GET_REGISTERS; break;
+		case PTRACE_SETREGSET: counter = COUNTER_PTRACE_SET_REGISTERS; break;
+		case PTRACE_GET_SYSCALL_INFO: counter = COUNTER_PTRACE_GET_SYSCALL_INFO; break;
+		case PTRACE_PEEKDATA: case PTRACE_PEEKTEXT: counter = COUNTER_PTRACE_PEEK; break;
+		case PTRACE_POKEDATA: case PTRACE_POKETEXT: counter = COUNTER_PTRACE_POKE; break;
+		case PTRACE_GETEVENTMSG: counter = COUNTER_PTRACE_GET_EVENT_MESSAGE; break;
+		case PTRACE_SETOPTIONS: counter = COUNTER_PTRACE_SET_OPTIONS; break;
+		case PTRACE_TRACEME: case PTRACE_ATTACH: case PTRACE_SEIZE: counter = COUNTER_PTRACE_ATTACH; break;
+		case PTRACE_INTERRUPT: counter = COUNTER_PTRACE_INTERRUPT; break;
+		case PTRACE_DETACH: counter = COUNTER_PTRACE_DETACH; break;
+	}
+	tracer_count(counter);
+}
+
+/**
+ * @brief Account for the CPU time in `usage`, as returned by wait4 for a
+ * thread of process `process`; only the growth since the last report for
+ * that process is counted. `exited` forgets the process.
+ */
+void tracer_count_tracee_usage(pid_t process, const struct rusage& usage, bool exited);
+
+uint64_t tracer_counter_clock();
+
+/**
+ * @brief `waitpid` that counts the call, its time and interruptions, and
+ * fills `usage` like `wait4`.
+ */
+pid_t tracer_wait(pid_t pid, int *status, int options, struct rusage *usage);
+
+#define TRACER_COUNT(counter, n) tracer_count(counter, n)
+#define TRACER_COUNT_PTRACE(request) tracer_count_ptrace(request)
+#define TRACER_COUNT_STOP(reason) tracer_count((enum tracer_counter)(COUNTER_STOPS + (reason)))
+#define TRACER_COUNT_USAGE(thread, process, usage, status) \
+	tracer_count_tracee_usage(process, usage, (thread) == (process) && (WIFEXITED(status) || WIFSIGNALED(status)))
+
+#else
+
+static inline pid_t tracer_wait(pid_t pid, int *status, int options, struct rusage *) {
+	return waitpid(pid, status, options);
+}
+
+#define TRACER_COUNT(counter, n) do {} while(0)
+#define TRACER_COUNT_PTRACE(request) do {} while(0)
+#define TRACER_COUNT_STOP(reason) do {} while(0)
+#define TRACER_COUNT_USAGE(thread, process, usage, status) do {} while(0)
+
+#endif
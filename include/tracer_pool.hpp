@@ -0,0 +1,193 @@
+#pragma once
+#include <sys/types.h>      // pid_t
+#include <pthread.h>        // pthread_t
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>       // std::function
+#include <future>           // std::future, std::promise
+#include <memory>           // std::unique_ptr
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "tracer.hpp"
+#include "tracer_session.hpp"
+#include "spsc_ring.hpp"
+
+/**
+ * @brief A stop observed by a `tracer_pool` worker, as published to
+ * consumers of the pool.
+ */
+struct tracer_pool_event {
+	pid_t process_id;
+	pid_t thread_group_id;
+	enum stop_reason stop_reason;
+	int status;
+	long syscall_number;  // -1 unless stopped at a system call
+	long syscall_arguments[6];  // At system call entries; Linux system calls take at most six
+	long syscall_return_value;  // At SYSCALL_EXIT
+	size_t worker;
+	uint64_t lost_before;  // Events of this worker discarded right before this one, under SPSC_COUNT
+};
+
+/**
+ * @brief Traces many processes with several threads.
+ *
+ * ptrace ties each tracee to the thread that attached it, and every
+ * request for it must come from that thread. A pool therefore runs
+ * `workers` threads, each with its own `tracer_session` holding a shard of
+ * the tracees: the ones it spawned or attached, and everything they fork
+ * or clone in turn. New tracees go to the worker with the fewest.
+ *
+ * Each stop is handled on the owning worker by the pool's handler, which
+ * receives the tracee's `tracer` and is expected to resume it, like a loop
+ * over `tracer_session::next_event` would. If the pool was created with an
+ * event capacity, every stop is also published as a `tracer_pool_event`
+ * through a lock-free ring per worker, for one consumer thread to take
+ * with `next_event`. What happens when a ring is full depends on the
+ * pool's overflow policy: under SPSC_BLOCK, the worker waits, which in
+ * turn stalls its tracees, until the consumer catches up; under SPSC_DROP
+ * and SPSC_COUNT, the event is discarded and the handler still runs, so
+ * tracees never wait for the consumer. `event_statistics` reports how
+ * often each happened.
+ *
+ * Other threads act on tracees only through the pool: `spawn`, `attach`
+ * and `execute` queue a command for the owning worker, interrupt its
+ * `waitpid` with `wake_signal()`, and complete the returned future once
+ * the worker has run the command. The pool installs a handler for that
+ * signal without `SA_RESTART`.
+ */
+class tracer_pool {
+public:
+
+	typedef std::function<void(tracer&, enum stop_reason)> event_handler;
+
+private:
+
+	struct worker {
+		size_t index;
+		std::thread thread;
+		pthread_t native_thread;
+		tracer_session session;
+		std::atomic<size_t> tracees;
+		spsc_ring<struct tracer_pool_event> events;
+
+		// Commands from other threads; guarded by `mutex`.
+		std::mutex mutex;
+		std::condition_variable commands_available;
+		std::condition_variable commands_taken;
+		std::deque<std::function<void()>> commands;
+		uint64_t n_submitted = 0;
+		uint64_t n_taken = 0;
+		bool finished = false;
+
+		worker(size_t index, size_t event_capacity, enum spsc_overflow_policy overflow)
+			: index(index), tracees(0), events(event_capacity > 0 ? event_capacity : 1, overflow) {}
+	};
+
+	std::vector<std::unique_ptr<struct worker>> _workers;
+
+	const event_handler _handler;
+
+	const bool _publish_events;
+
+	std::atomic<bool> _stopping;
+
+	std::atomic<size_t> _running_workers;
+
+	std::mutex _owners_mutex;
+	std::unordered_map<pid_t, size_t> _owners;  // Tracee thread id to worker index
+
+	// Lets the consumer sleep while all rings are empty.
+	std::mutex _events_mutex;
+	std::condition_variable _events_available;
+	std::atomic<bool> _consumer_waiting;
+	size_t _next_ring = 0;
+
+	void _run(struct worker& worker);
+
+	void _run_commands(struct worker& worker);
+
+	void _handle(struct worker& worker, const struct tracer_event& event);
+
+	void _submit(struct worker& worker, std::function<void()> command);
+
+	struct worker& _least_loaded();
+
+	struct worker *_owner(pid_t pid);
+
+public:
+
+	/**
+	 * @brief Start `workers` threads. `handler` is called on the owning
+	 * worker for every stop of every tracee. With an `event_capacity`
+	 * above 0, stops are also published for `next_event`, with up to that
+	 * many pending per worker, and `overflow` deciding what happens to
+	 * events beyond that.
+	 */
+	tracer_pool(size_t workers, event_handler handler, size_t event_capacity=0,
+	            enum spsc_overflow_policy overflow=SPSC_BLOCK);
+
+	tracer_pool(const tracer_pool&) = delete;
+	tracer_pool& operator=(const tracer_pool&) = delete;
+
+	/**
+	 * @brief Calls `shutdown`.
+	 */
+	~tracer_pool();
+
+	/**
+	 * @brief Fork a new tracee on the least loaded worker. The child runs
+	 * `child_main`, which should `exec` (the child of a multi-threaded
+	 * process may only call async-signal-safe functions), and exits with
+	 * 127 if it returns, throws, or the child cannot accept tracing. The
+	 * child then prints the exception's message to stderr, if any.
+	 */
+	std::future<pid_t> spawn(std::function<void()> child_main);
+
+	/**
+	 * @brief Attach to a running process on the least loaded worker.
+	 */
+	std::future<void> attach(pid_t pid);
+
+	/**
+	 * @brief Run `command` with the tracer of thread `pid` on the worker
+	 * owning it, e.g. to resume a tracee the handler left stopped. The
+	 * future holds a `tracer_exception` if there is no such tracee.
+	 */
+	std::future<void> execute(pid_t pid, std::function<void(tracer&)> command);
+
+	/**
+	 * @brief Take the next published stop, blocking until one is available.
+	 * Returns false once the pool has shut down and all events were taken.
+	 * Only one thread may consume events.
+	 */
+	bool next_event(struct tracer_pool_event& event);
+
+	/**
+	 * @brief Like `next_event`, but return false right away if no event is
+	 * pending.
+	 */
+	bool try_next_event(struct tracer_pool_event& event);
+
+	/**
+	 * @brief Stop accepting work and wait for the workers to finish, which
+	 * they do once all their tracees have exited or been detached.
+	 */
+	void shutdown();
+
+	inline size_t workers() const { return _workers.size(); };
+
+	/**
+	 * @brief Counters of the event ring of worker `worker`; may be called
+	 * from any thread.
+	 */
+	inline struct spsc_ring_statistics event_statistics(size_t worker) const { return _workers.at(worker)->events.statistics(); };
+
+	/**
+	 * @brief The signal used to interrupt workers blocked in `waitpid`.
+	 */
+	static int wake_signal();
+
+};
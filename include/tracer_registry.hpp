@@ -0,0 +1,109 @@
+#pragma once
+#include <sys/types.h>      // pid_t
+#include <cstdint>          // uint32_t
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include "tracer.hpp"
+
+/**
+ * @brief Flat storage for tracers of a process tree.
+ *
+ * Tracers live in slots that never move, so pointers to them stay valid
+ * until the slot is released. Released slots are reused for new tracers
+ * before the storage grows, so tracing many short-lived processes does not
+ * keep allocating. A `tracer_handle` names a slot together with the
+ * generation of the tracer in it; once the slot is released, the handle
+ * no longer resolves, even after the slot has been reused.
+ *
+ * Children forked by a tracer are created in the registry of their parent
+ * (see `tracer::children`). A `tracer_session` keeps all its tracees in
+ * one registry.
+ */
+class tracer_registry {
+	friend class tracer;
+	friend class tracer_session;
+
+private:
+
+	struct slot {
+		class tracer tracer;
+		uint32_t generation = 0;
+		bool used = false;
+	};
+
+	std::deque<struct slot> _slots;
+
+	std::vector<uint32_t> _free_slots;
+
+	std::unordered_map<pid_t, uint32_t> _slots_by_pid;
+
+	std::unordered_map<pid_t, std::vector<uint32_t>> _slots_by_thread_group;
+
+	tracer_handle _add();
+
+	void _index(tracer& indexed);
+
+	void _unindex(tracer& unindexed);
+
+public:
+
+	tracer_registry() = default;
+
+	// Tracers point back to their registry.
+	tracer_registry(const tracer_registry&) = delete;
+	tracer_registry& operator=(const tracer_registry&) = delete;
+
+	/**
+	 * @brief The tracer for `handle`, or NULL if its slot has been
+	 * released since.
+	 */
+	tracer *get(tracer_handle handle);
+
+	/**
+	 * @brief The tracer of the given process, or NULL if there is none, or
+	 * it has exited or been detached.
+	 */
+	tracer *find(pid_t pid);
+
+	/**
+	 * @brief Destroy the tracer for `handle` and make its slot available
+	 * for reuse. Does nothing if the handle is already stale.
+	 */
+	void release(tracer_handle handle);
+
+	/**
+	 * @brief Number of tracees in the registry that have neither exited
+	 * nor been detached.
+	 */
+	inline size_t size() const { return _slots_by_pid.size(); };
+
+	/**
+	 * @brief Call `f(tracer&)` for each tracee of the given thread group
+	 * that has neither exited nor been detached.
+	 */
+	template<typename function>
+	void for_each_thread(pid_t thread_group_id, function f) {
+		auto group = _slots_by_thread_group.find(thread_group_id);
+		if(group == _slots_by_thread_group.end()) {
+			return;
+		}
+		for(uint32_t index : group->second) {
+			f(_slots[index].tracer);
+		}
+	}
+
+	/**
+	 * @brief Call `f(tracer&)` for each tracer that has not been released,
+	 * in slot order.
+	 */
+	template<typename function>
+	void for_each(function f) {
+		for(struct slot& slot : _slots) {
+			if(slot.used) {
+				f(slot.tracer);
+			}
+		}
+	}
+
+};
@@ -0,0 +1,200 @@
+#pragma once
+#include <sys/types.h>      // pid_t
+#include <deque>
+#include <functional>       // std::function
+#include <unordered_map>
+#include <vector>
+#include "tracer.hpp"
+#include "tracer_registry.hpp"
+
+/**
+ * @brief A stop of one of the tracees of a `tracer_session`.
+ */
+struct tracer_event {
+	class tracer *tracer;
+	enum stop_reason stop_reason;
+};
+
+/**
+ * @brief Owns a set of tracees, including all processes they fork, and
+ * waits for stops of any of them at once.
+ *
+ * A single `tracer::wait` only ever waits on its own tracee, so tracing a
+ * process tree with one tracer per process would starve all but the one
+ * being waited on. A session instead waits with `waitpid(-1, __WALL)` and
+ * routes each wait status to the `tracer` of that process, queueing the
+ * resulting stops in the order they arrived:
+ *
+ *     tracer_session session;
+ *     if(session.fork() == 0) {
+ *         execvp(...);
+ *     }
+ *     struct tracer_event event;
+ *     while(session.next_event(event)) {
+ *         if(event.stop_reason != EXITED) {
+ *             event.tracer->resume(SYSCALL_ENTRY);
+ *         }
+ *     }
+ *
+ * Every tracee of a session traces its children and threads
+ * (`set_trace_children`, `set_trace_threads`).
+ * Each tracee that joins the session, whether through `fork`, `attach`, or
+ * by being forked by another tracee, is reported once with the stop it is
+ * in when it joins. Tracers of tracees that exited or were detached stay
+ * valid until the following `next_event` call, after which their registry
+ * slots are reused. All tracees must be resumed through their `tracer`
+ * and are then waited on through `next_event`. Since it waits for any
+ * child, a session should be the only thing reaping children of the
+ * calling process.
+ */
+class tracer_session {
+	friend class tracer;
+	friend class tracer_pool;
+
+private:
+
+	tracer_registry _registry;
+
+	std::deque<struct tracer_event> _events;
+
+	std::vector<tracer_handle> _finished;  // Released at the next `next_event`
+
+	/* Wait statuses reaped for processes we did not know yet, e.g. the
+	   initial stop of a new child that is reported before its parent's
+	   fork event. */
+	std::unordered_map<pid_t, std::vector<int>> _unclaimed_statuses;
+
+	/* For sessions run by a `tracer_pool` worker: only reap tracees of
+	   the calling thread, and return from a blocking wait when it is
+	   interrupted by a signal. */
+	bool _this_thread_only = false;
+
+	std::function<void(tracer&)> _on_adopt;
+
+	int _event_fd = -1;  // signalfd for SIGCHLD, once requested
+
+	tracer& _add_root();
+
+	void _track(tracer& new_tracer);
+
+	void _adopt(tracer& new_tracer);
+
+	void _forget(tracer& forgotten);
+
+	void _vanish(tracer& vanished);
+
+	bool _take_unclaimed_status(pid_t pid, int& status);
+
+	void _dispatch(pid_t pid, int status);
+
+	bool _reap(bool block);
+
+	bool _pop_event(struct tracer_event& event);
+
+public:
+
+	tracer_session() = default;
+
+	/**
+	 * @brief Closes the `event_fd`, if any. Tracees are left as they are.
+	 */
+	~tracer_session();
+
+	// Tracers point back to their session.
+	tracer_session(const tracer_session&) = delete;
+	tracer_session& operator=(const tracer_session&) = delete;
+
+	/**
+	 * @brief Fork a new tracee into this session, like `tracer::fork`.
+	 * Returns 0 in the child and the child's process id in the tracer.
+	 */
+	pid_t fork();
+
+	/**
+	 * @brief Fork a new tracee with a seccomp filter, like
+	 * `tracer::fork(traced_syscalls)`.
+	 */
+	pid_t fork(const std::vector<long>& traced_syscalls);
+
+	/**
+	 * @brief Attach to a running process and add it to this session.
+	 */
+	tracer& attach(pid_t pid);
+
+	/**
+	 * @brief Seize a running thread and add it to this session, like
+	 * `tracer::seize`.
+	 */
+	tracer& seize(pid_t pid);
+
+	/**
+	 * @brief Seize every thread of the process of `pid` and, if
+	 * `descendants` is set, of every process descending from it, without
+	 * waiting for any of them to stop.
+	 *
+	 * All threads found in /proc/<pid>/task are seized and interrupted
+	 * first; their stops are then reported by `next_event` as
+	 * `INTERRUPTED` as they come in, so that attaching to many threads
+	 * takes about as long as attaching to one. Threads created meanwhile
+	 * by threads not yet seized are caught by rescanning until a scan
+	 * finds nothing new; those created by seized threads, and processes
+	 * they fork, are traced automatically and reported like any other
+	 * new tracee. Descendants are found through
+	 * /proc/<pid>/task/<tid>/children, which requires
+	 * `CONFIG_PROC_CHILDREN`.
+	 *
+	 * Returns the number of threads seized. Threads that exit during the
+	 * scan are skipped; any other failure throws, leaving the threads
+	 * seized so far in the session.
+	 */
+	size_t seize_process(pid_t pid, bool descendants=false);
+
+	/**
+	 * @brief The tracer of the given process in this session, or NULL if
+	 * there is none, or it has exited or been detached.
+	 */
+	inline tracer *find(pid_t pid) { return _registry.find(pid); };
+
+	/**
+	 * @brief Number of tracees that have neither exited nor been detached.
+	 */
+	inline size_t size() const { return _registry.size(); };
+
+	/**
+	 * @brief All tracers of this session, for iteration or lookup by handle.
+	 */
+	inline tracer_registry& registry() { return _registry; };
+
+	/**
+	 * @brief Return the next stop of any tracee, in the order the stops
+	 * were observed, blocking until there is one. Each time it blocks, all
+	 * other statuses that are already pending are collected as well.
+	 * Returns false once there are no queued events and no tracees left
+	 * to wait for.
+	 */
+	bool next_event(struct tracer_event& event);
+
+	/**
+	 * @brief Like `next_event`, but return false right away if no stop is
+	 * pending, e.g. for a loop driven by `event_fd`.
+	 */
+	bool try_next_event(struct tracer_event& event);
+
+	/**
+	 * @brief A descriptor that polls readable when tracees may have
+	 * stopped, to wait on with `poll` or `epoll` next to other
+	 * descriptors. Whenever it is readable, call `try_next_event` until
+	 * it returns false; this also resets the descriptor.
+	 *
+	 * It is a `signalfd` for SIGCHLD, which the kernel sends the tracer
+	 * for every stop and exit of a tracee. The first call creates it and
+	 * blocks SIGCHLD in the calling thread, which it must remain in all
+	 * threads of the process for the descriptor to see it; create it
+	 * before starting other threads, or block SIGCHLD in them as well.
+	 * Stops that happened before the first call may not make it readable,
+	 * so drain `try_next_event` once after creating it. (A pidfd would
+	 * only become readable on exit, not on ptrace stops.)
+	 */
+	int event_fd();
+
+};
@@ -0,0 +1,25 @@
+#include <arm_neon.h>   // NEON intrinsics
+#include <cstdint>      // uint64_t
+#include "tracer.hpp"
+
+size_t tracer::_find_nul(const char *buffer, size_t length) {
+	const uint8x16_t zero = vdupq_n_u8(0);
+	size_t i = 0;
+	for(; i + 16 <= length; i += 16) {
+		const uint8x16_t chunk = vld1q_u8((const uint8_t *)(buffer + i));
+		const uint8x16_t matches = vceqq_u8(chunk, zero);
+		/* Narrow each byte of the comparison result to a nibble, which
+		   gives a 64 bit mask with four bits per input byte. */
+		const uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+		const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+		if(mask != 0) {
+			return i + (__builtin_ctzll(mask) >> 2);
+		}
+	}
+	for(; i < length; i++) {
+		if(buffer[i] == 0) {
+			return i;
+		}
+	}
+	return length;
+}
@@ -1,16 +1,21 @@
 #include <sys/uio.h>    // struct iovec
 #include <linux/elf.h>  // NT_PRSTATUS, NT_ARM_SYSTEM_CALL
+#include <linux/audit.h> // AUDIT_ARCH_AARCH64
 #include <cstring>      // strerror
 #include <errno.h>      // errno
 #include "tracer.hpp"
+#include "tracer_counters.hpp"
 
 const int tracer::n_syscall_arguments = 7;
+const int tracer::syscall_instruction_length = 4;  // svc #0
+const uint32_t tracer::_audit_architecture = AUDIT_ARCH_AARCH64;
 
 long tracer::_read_registers_internal(pid_t pid, struct user_regs_struct& destination) {
 	struct iovec iov {
 		(void *)&destination,
 		sizeof(destination)
 	};
+	TRACER_COUNT_PTRACE(PTRACE_GETREGSET);
 	return ptrace(PTRACE_GETREGSET, pid, NT_PRSTATUS, &iov);
 }
 
@@ -19,16 +24,18 @@ long tracer::_write_registers_internal(pid_t pid, const struct user_regs_struct&
 		(void *)&source,
 		sizeof(source)
 	};
+	TRACER_COUNT_PTRACE(PTRACE_SETREGSET);
 	return ptrace(PTRACE_SETREGSET, pid, NT_PRSTATUS, &iov);
 }
 
-long tracer::get_syscall_number() {
+long tracer::_read_syscall_number() {
 	tracer_ensure_invariants();
 	int syscall_number;
 	struct iovec iov {
 		(void *)&syscall_number,
 		sizeof(syscall_number)
 	};
+	TRACER_COUNT_PTRACE(PTRACE_GETREGSET);
 	if(ptrace(PTRACE_GETREGSET, tracee.process_id, NT_ARM_SYSTEM_CALL, &iov) != 0) {
 		throw tracer_exception("Unable to read ARM-specific system call register: " + std::to_string(errno) + " " + std::string(strerror(errno)));
 	}
@@ -47,12 +54,14 @@ void tracer::set_syscall_number(long number) {
 		(void *)&new_registers.regs[8],
 		sizeof(new_registers.regs[8])
 	};
+	tracee.syscall_info_valid = false;
+	TRACER_COUNT_PTRACE(PTRACE_SETREGSET);
 	if(ptrace(PTRACE_SETREGSET, tracee.process_id, NT_ARM_SYSTEM_CALL, &iov) != 0) {
 		throw tracer_exception("Unable to write ARM-specific system call register: " + std::to_string(errno) + " " + std::string(strerror(errno)));
 	}
 }
 
-long tracer::get_syscall_argument(size_t i) {
+long tracer::_read_syscall_argument(size_t i) {
 	// See e.g. glibc sysdeps/unix/sysv/linux/aarch64/syscall.S
 	// for system call arguments and corresponding registers
 	tracer_ensure_invariants();
@@ -73,7 +82,7 @@ void tracer::set_syscall_argument(size_t i, long value) {
 	write_registers(new_registers);
 }
 
-long tracer::get_syscall_return_value() {
+long tracer::_read_syscall_return_value() {
 	tracer_ensure_invariants();
 	const struct user_regs_struct& registers = read_registers();
 	return registers.regs[0];
@@ -85,3 +94,20 @@ void tracer::set_syscall_return_value(long value) {
 	new_registers.regs[0] = value;
 	write_registers(new_registers);
 }
+
+long tracer::_read_instruction_pointer() {
+	tracer_ensure_invariants();
+	return read_registers().pc;
+}
+
+long tracer::_read_stack_pointer() {
+	tracer_ensure_invariants();
+	return read_registers().sp;
+}
+
+void tracer::_rewind_syscall(long number) {
+	struct user_regs_struct new_registers = read_registers();
+	new_registers.pc -= syscall_instruction_length;
+	new_registers.regs[8] = number;
+	write_registers(new_registers);
+}
@@ -0,0 +1,82 @@
+#include "tracer_coroutine.hpp"
+
+tracer_scheduler::tracer_scheduler(task_factory trace)
+	: _trace(trace)
+{
+}
+
+uint64_t tracer_scheduler::_key(const tracer& tracee) {
+	const tracer_handle handle = tracee.handle();
+	return ((uint64_t)handle.generation << 32) | handle.index;
+}
+
+void tracer_scheduler::stop_awaiter::await_suspend(std::coroutine_handle<> waiting) {
+	struct tracee& state = _scheduler._tracees[_key(_tracer)];
+	_tracer.resume(_until);
+	state.waiting = waiting;
+	state.until = _until;
+}
+
+pid_t tracer_scheduler::fork() {
+	return _session.fork();
+}
+
+tracer& tracer_scheduler::attach(pid_t pid) {
+	return _session.attach(pid);
+}
+
+size_t tracer_scheduler::seize_process(pid_t pid, bool descendants) {
+	return _session.seize_process(pid, descendants);
+}
+
+void tracer_scheduler::_step(tracer& target, struct tracee& state, std::coroutine_handle<> coroutine) {
+	coroutine.resume();
+	if(!state.task._coroutine.done()) {
+		return;
+	}
+	std::exception_ptr exception = state.task._coroutine.promise().exception;
+	if(target.stop_reason() != NOT_STOPPED && target.stop_reason() != EXITED) {
+		target.detach();
+	}
+	if(target.stop_reason() == EXITED || target.process_id() == -1) {
+		_tracees.erase(_key(target));
+	}
+	if(exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+void tracer_scheduler::run() {
+	struct tracer_event event;
+	while(_session.next_event(event)) {
+		tracer& target = *event.tracer;
+		const uint64_t key = _key(target);
+		auto found = _tracees.find(key);
+		if(found == _tracees.end()) {
+			if(event.stop_reason == EXITED) {
+				continue;
+			}
+			// Joined the session; the task awaits its first stop itself.
+			struct tracee& state = _tracees[key];
+			state.task = _trace(*this, target);
+			_step(target, state, state.task._coroutine);
+			continue;
+		}
+		struct tracee& state = found->second;
+		if(!state.waiting) {
+			// Its task returned while the tracee was running.
+			if(event.stop_reason != EXITED) {
+				target.detach();
+			}
+			_tracees.erase(found);
+			continue;
+		}
+		if(event.stop_reason != state.until && event.stop_reason != EXITED) {
+			target.resume(state.until);
+			continue;
+		}
+		std::coroutine_handle<> waiting = state.waiting;
+		state.waiting = nullptr;
+		_step(target, state, waiting);
+	}
+}
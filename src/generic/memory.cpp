@@ -0,0 +1,401 @@
+#include <unistd.h>     // sysconf, pread, pwrite, close
+#include <fcntl.h>      // open
+#include <sys/uio.h>    // process_vm_readv, process_vm_writev
+#include <sys/ptrace.h> // PTRACE_PEEKDATA, PTRACE_POKEDATA
+#include <climits>      // IOV_MAX
+#include <cerrno>       // errno
+#include <cstring>      // memcpy, strerror
+#include <cstdint>      // uintptr_t
+#include <algorithm>    // std::min, std::fill
+#include "tracer.hpp"
+#include "tracer_counters.hpp"
+
+static size_t page_size() {
+	static const size_t size = sysconf(_SC_PAGESIZE);
+	return size;
+}
+
+/**
+ * @brief Number of bytes from `address` to the end of the page containing it.
+ */
+static size_t bytes_to_page_end(uintptr_t address) {
+	return page_size() - (address & (page_size() - 1));
+}
+
+/**
+ * @brief Split the tracee range [offset, offset+length) into page-bounded
+ * iovecs, so that a partial transfer of process_vm_readv/writev, which only
+ * happens at iovec granularity, can only ever stop at a page boundary. At
+ * most `max_iovecs` are filled; returns how many were.
+ */
+static int split_at_pages(void *offset, size_t length, struct iovec *iovecs, int max_iovecs) {
+	uintptr_t address = (uintptr_t)offset;
+	int n = 0;
+	while(length > 0 && n < max_iovecs) {
+		size_t chunk = std::min(length, bytes_to_page_end(address));
+		iovecs[n].iov_base = (void *)address;
+		iovecs[n].iov_len = chunk;
+		address += chunk;
+		length -= chunk;
+		n++;
+	}
+	return n;
+}
+
+tracer::memory_file::~memory_file() {
+	close(fd);
+}
+
+size_t tracer::read_memory(void *offset, void *destination, size_t length) {
+	tracer_ensure_invariants();
+	switch(_settings.memory_backend) {
+		case MEMORY_PTRACE:
+			return _read_memory_ptrace(offset, destination, length);
+		case MEMORY_PROC_MEM:
+			return _read_memory_proc_mem(offset, destination, length);
+		default:
+			break;
+	}
+	char *remote = (char *)offset;
+	char *local = (char *)destination;
+	size_t done = 0;
+	while(done < length) {
+		done += _read_memory_process_vm(remote + done, local + done, length - done);
+		if(done == length) {
+			break;
+		}
+		/* The page at remote + done is not reachable through
+		   process_vm_readv. Try ptrace for the rest of that page, then
+		   continue in bulk. */
+		size_t chunk = std::min(length - done, bytes_to_page_end((uintptr_t)(remote + done)));
+		size_t read = _read_memory_ptrace(remote + done, local + done, chunk);
+		done += read;
+		if(read < chunk) {
+			break;
+		}
+	}
+	return done;
+}
+
+size_t tracer::write_memory(void *offset, const void *source, size_t length) {
+	tracer_ensure_invariants();
+	_invalidate_memory_cache();
+	switch(_settings.memory_backend) {
+		case MEMORY_PTRACE:
+			return _write_memory_ptrace(offset, source, length);
+		case MEMORY_PROC_MEM:
+			return _write_memory_proc_mem(offset, source, length);
+		default:
+			break;
+	}
+	char *remote = (char *)offset;
+	const char *local = (const char *)source;
+	size_t done = 0;
+	while(done < length) {
+		done += _write_memory_process_vm(remote + done, local + done, length - done);
+		if(done == length) {
+			break;
+		}
+		size_t chunk = std::min(length - done, bytes_to_page_end((uintptr_t)(remote + done)));
+		size_t written = _write_memory_ptrace(remote + done, local + done, chunk);
+		done += written;
+		if(written < chunk) {
+			break;
+		}
+	}
+	return done;
+}
+
+size_t tracer::_read_memory_process_vm(void *offset, void *destination, size_t length) {
+	struct iovec remote_iovecs[IOV_MAX];
+	size_t done = 0;
+	while(done < length) {
+		int n_remote = split_at_pages((char *)offset + done, length - done, remote_iovecs, IOV_MAX);
+		size_t requested = 0;
+		for(int i = 0; i < n_remote; i++) {
+			requested += remote_iovecs[i].iov_len;
+		}
+		struct iovec local_iovec {
+			(char *)destination + done,
+			requested
+		};
+		ssize_t read = process_vm_readv(tracee.process_id, &local_iovec, 1, remote_iovecs, n_remote, 0);
+		if(read <= 0) {
+			break;
+		}
+		done += read;
+		if((size_t)read < requested) {
+			break;
+		}
+	}
+	TRACER_COUNT(COUNTER_MEMORY_BYTES_READ, done);
+	return done;
+}
+
+size_t tracer::_write_memory_process_vm(void *offset, const void *source, size_t length) {
+	struct iovec remote_iovecs[IOV_MAX];
+	size_t done = 0;
+	while(done < length) {
+		int n_remote = split_at_pages((char *)offset + done, length - done, remote_iovecs, IOV_MAX);
+		size_t requested = 0;
+		for(int i = 0; i < n_remote; i++) {
+			requested += remote_iovecs[i].iov_len;
+		}
+		struct iovec local_iovec {
+			(char *)source + done,
+			requested
+		};
+		ssize_t written = process_vm_writev(tracee.process_id, &local_iovec, 1, remote_iovecs, n_remote, 0);
+		if(written <= 0) {
+			break;
+		}
+		done += written;
+		if((size_t)written < requested) {
+			break;
+		}
+	}
+	TRACER_COUNT(COUNTER_MEMORY_BYTES_WRITTEN, done);
+	return done;
+}
+
+size_t tracer::_read_memory_ptrace(void *offset, void *destination, size_t length) {
+	/* Only ever peek at aligned words; an aligned word never straddles a
+	   page boundary, so we cannot fail on bytes we were not asked for. */
+	const uintptr_t start = (uintptr_t)offset;
+	uintptr_t word_address = start & ~(uintptr_t)(sizeof(long) - 1);
+	size_t done = 0;
+	for(; done < length; word_address += sizeof(long)) {
+		errno = 0;
+		TRACER_COUNT_PTRACE(PTRACE_PEEKDATA);
+		long word = ptrace(PTRACE_PEEKDATA, tracee.process_id, (void *)word_address, 0);
+		if(errno == EIO || errno == EFAULT) {
+			break;
+		} else if(errno != 0) {
+			throw tracer_exception("Unable to peek data at " + std::to_string(word_address) + ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
+		}
+		const size_t skip = (word_address < start ? start - word_address : 0);
+		const size_t n = std::min(sizeof(long) - skip, length - done);
+		memcpy((char *)destination + done, (char *)&word + skip, n);
+		done += n;
+	}
+	TRACER_COUNT(COUNTER_MEMORY_BYTES_READ, done);
+	return done;
+}
+
+size_t tracer::_write_memory_ptrace(void *offset, const void *source, size_t length) {
+	const uintptr_t start = (uintptr_t)offset;
+	uintptr_t word_address = start & ~(uintptr_t)(sizeof(long) - 1);
+	size_t done = 0;
+	for(; done < length; word_address += sizeof(long)) {
+		const size_t skip = (word_address < start ? start - word_address : 0);
+		const size_t n = std::min(sizeof(long) - skip, length - done);
+		long word = 0;
+		if(n < sizeof(long)) {
+			// Partial word; preserve the bytes around the written ones.
+			if(_read_memory_ptrace((void *)word_address, &word, sizeof(long)) < sizeof(long)) {
+				break;
+			}
+		}
+		memcpy((char *)&word + skip, (const char *)source + done, n);
+		TRACER_COUNT_PTRACE(PTRACE_POKEDATA);
+		if(ptrace(PTRACE_POKEDATA, tracee.process_id, (void *)word_address, word) != 0) {
+			if(errno == EIO || errno == EFAULT) {
+				break;
+			}
+			throw tracer_exception("Unable to poke data at " + std::to_string(word_address) + ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
+		}
+		done += n;
+	}
+	TRACER_COUNT(COUNTER_MEMORY_BYTES_WRITTEN, done);
+	return done;
+}
+
+size_t tracer::read_memory_batch(struct memory_region *regions, size_t n_regions) {
+	tracer_ensure_invariants();
+	struct iovec local_iovecs[IOV_MAX];
+	struct iovec remote_iovecs[IOV_MAX];
+	size_t n_success = 0;
+	size_t i = 0;
+	while(i < n_regions) {
+		size_t n_batch = 0;
+		if(_settings.memory_backend == MEMORY_PROCESS_VM) {
+			for(; n_batch < IOV_MAX && i + n_batch < n_regions; n_batch++) {
+				const struct memory_region& region = regions[i + n_batch];
+				local_iovecs[n_batch].iov_base = region.destination;
+				local_iovecs[n_batch].iov_len = region.length;
+				remote_iovecs[n_batch].iov_base = region.offset;
+				remote_iovecs[n_batch].iov_len = region.length;
+			}
+			ssize_t read = process_vm_readv(tracee.process_id, local_iovecs, n_batch, remote_iovecs, n_batch, 0);
+			size_t remaining = (read > 0 ? read : 0);
+			TRACER_COUNT(COUNTER_MEMORY_BYTES_READ, remaining);
+			// Regions fully covered by the transfer were read in full.
+			size_t n_read = 0;
+			for(; n_read < n_batch && regions[i + n_read].length <= remaining; n_read++) {
+				remaining -= regions[i + n_read].length;
+				regions[i + n_read].success = true;
+			}
+			n_success += n_read;
+			i += n_read;
+			if(n_read == n_batch) {
+				continue;
+			}
+		}
+		// Region i stopped the batch, or we cannot batch; read it on its own.
+		struct memory_region& region = regions[i];
+		region.success = (read_memory(region.offset, region.destination, region.length) == region.length);
+		n_success += (region.success ? 1 : 0);
+		i++;
+	}
+	return n_success;
+}
+
+std::string tracer::read_string(void *offset, size_t max_length, bool *terminated) {
+	tracer_ensure_invariants();
+	/* With word-wise ptrace, reading ahead to the end of the page would
+	   cost one syscall per word past the terminator. */
+	const size_t chunk_size = (_settings.memory_backend == MEMORY_PTRACE ? sizeof(long) : page_size());
+	std::string result;
+	std::vector<char> buffer;
+	uintptr_t address = (uintptr_t)offset;
+	bool found = false;
+	while(result.size() < max_length) {
+		const size_t wanted = std::min(max_length - result.size(), chunk_size - (address & (chunk_size - 1)));
+		const char *chunk = NULL;
+		size_t available = 0;
+		const char *page = _cached_page(address & ~(uintptr_t)(page_size() - 1));
+		if(page != NULL) {
+			chunk = page + (address & (page_size() - 1));
+			available = wanted;
+		} else {
+			buffer.resize(wanted);
+			available = read_memory((void *)address, buffer.data(), wanted);
+			chunk = buffer.data();
+		}
+		if(available == 0 && address == (uintptr_t)offset) {
+			throw tracer_exception("Unable to read string at " + std::to_string(address) + ".");
+		}
+		const size_t length = _find_nul(chunk, available);
+		result.append(chunk, length);
+		if(length < available) {
+			found = true;
+			break;
+		}
+		if(available < wanted) {
+			break;
+		}
+		address += available;
+	}
+	if(terminated != NULL) {
+		*terminated = found;
+	}
+	return result;
+}
+
+int tracer::_memory_file_descriptor() {
+	if(tracee.memory_file) {
+		return tracee.memory_file->fd;
+	}
+	const std::string path = "/proc/" + std::to_string(tracee.process_id) + "/mem";
+	int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+	if(fd == -1) {
+		throw tracer_exception("Unable to open " + path + ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
+	}
+	tracee.memory_file = std::make_shared<struct memory_file>(fd);
+	return fd;
+}
+
+size_t tracer::_read_memory_proc_mem(void *offset, void *destination, size_t length) {
+	size_t done = 0;
+	bool reopened = false;
+	while(done < length) {
+		ssize_t read = pread(_memory_file_descriptor(), (char *)destination + done, length - done, (off_t)((uintptr_t)offset + done));
+		if(read > 0) {
+			done += read;
+		} else if(read == 0 && !reopened) {
+			/* A descriptor whose address space is gone reads as
+			   end-of-file; this happens if we missed an exec. */
+			tracee.memory_file.reset();
+			reopened = true;
+		} else if(read == 0 || errno == EIO || errno == EFAULT) {
+			break;
+		} else if(errno != EINTR) {
+			throw tracer_exception("Unable to read memory at " + std::to_string((uintptr_t)offset + done) + ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
+		}
+	}
+	TRACER_COUNT(COUNTER_MEMORY_BYTES_READ, done);
+	return done;
+}
+
+size_t tracer::_write_memory_proc_mem(void *offset, const void *source, size_t length) {
+	size_t done = 0;
+	bool reopened = false;
+	while(done < length) {
+		ssize_t written = pwrite(_memory_file_descriptor(), (const char *)source + done, length - done, (off_t)((uintptr_t)offset + done));
+		if(written > 0) {
+			done += written;
+		} else if(written == 0 && !reopened) {
+			tracee.memory_file.reset();
+			reopened = true;
+		} else if(written == 0 || errno == EIO || errno == EFAULT) {
+			break;
+		} else if(errno != EINTR) {
+			throw tracer_exception("Unable to write memory at " + std::to_string((uintptr_t)offset + done) + ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
+		}
+	}
+	TRACER_COUNT(COUNTER_MEMORY_BYTES_WRITTEN, done);
+	return done;
+}
+
+/**
+ * Marker for an empty cache slot; never a page-aligned address.
+ */
+static const uintptr_t no_page = 1;
+
+void tracer::_invalidate_memory_cache() {
+	std::fill(tracee.memory_cache_pages.begin(), tracee.memory_cache_pages.end(), no_page);
+}
+
+const char *tracer::_cached_page(uintptr_t page_address) {
+	const size_t n_pages = _settings.memory_cache_pages;
+	if(n_pages == 0 || _settings.memory_backend == MEMORY_PTRACE) {
+		return NULL;
+	}
+	if(tracee.memory_cache_pages.size() != n_pages) {
+		tracee.memory_cache.resize(n_pages * page_size());
+		tracee.memory_cache_pages.assign(n_pages, no_page);
+		tracee.memory_cache_next = 0;
+	}
+	for(size_t i = 0; i < n_pages; i++) {
+		if(tracee.memory_cache_pages[i] == page_address) {
+			return &tracee.memory_cache[i * page_size()];
+		}
+	}
+	// Miss; evict round-robin and fill the slot with one bulk read.
+	const size_t slot = tracee.memory_cache_next;
+	tracee.memory_cache_next = (slot + 1) % n_pages;
+	char *page = &tracee.memory_cache[slot * page_size()];
+	tracee.memory_cache_pages[slot] = no_page;
+	if(read_memory((void *)page_address, page, page_size()) < page_size()) {
+		return NULL;
+	}
+	tracee.memory_cache_pages[slot] = page_address;
+	return page;
+}
+
+size_t tracer::_read_memory_cached(void *offset, void *destination, size_t length) {
+	uintptr_t address = (uintptr_t)offset;
+	size_t done = 0;
+	while(done < length) {
+		const char *page = _cached_page(address & ~(uintptr_t)(page_size() - 1));
+		if(page == NULL) {
+			break;
+		}
+		const size_t in_page = address & (page_size() - 1);
+		const size_t n = std::min(length - done, page_size() - in_page);
+		memcpy((char *)destination + done, page + in_page, n);
+		address += n;
+		done += n;
+	}
+	return done;
+}
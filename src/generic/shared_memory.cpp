@@ -0,0 +1,110 @@
+#include <unistd.h>       // ftruncate, close
+#include <fcntl.h>        // open
+#include <sys/mman.h>     // mmap, munmap, MFD_CLOEXEC
+#include <sys/syscall.h>  // syscall numbers
+#include <cerrno>         // errno
+#include <cstring>        // strerror
+#include "tracer.hpp"
+
+/**
+ * @brief Whether `value` returned from a system call signals an error.
+ */
+static bool is_syscall_error(long value) {
+	return value < 0 && value >= -4095;
+}
+
+tracer::shared_mapping::~shared_mapping() {
+	munmap(local, length);
+}
+
+void *tracer::map_shared_memory(size_t length) {
+	tracer_ensure_invariants();
+	if(tracee.shared_memory) {
+		throw tracer_exception("Tracee already has shared memory mapped.");
+	}
+	if(tracee.stop_reason != SYSCALL_ENTRY) {
+		throw tracer_exception("Shared memory can only be mapped at a system call entry stop.");
+	}
+	/* memfd_create needs its name in tracee memory. We put it below the
+	   stack pointer, past the x86_64 red zone, where the tracee keeps
+	   nothing across a system call. */
+	static const char name[] = "libtracer";
+	void *name_address = (void *)(((uintptr_t)get_stack_pointer() - 256) & ~(uintptr_t)15);
+	char overwritten[sizeof(name)];
+	if(read_memory(name_address, overwritten, sizeof(overwritten)) != sizeof(overwritten)
+	   || write_memory(name_address, name, sizeof(name)) != sizeof(name)) {
+		throw tracer_exception("Unable to write shared memory name to tracee stack.");
+	}
+	const long tracee_fd = inject_syscall(__NR_memfd_create, { (long)name_address, MFD_CLOEXEC });
+	// Signal handlers may have left something there; put it back.
+	if(write_memory(name_address, overwritten, sizeof(overwritten)) != sizeof(overwritten)) {
+		throw tracer_exception("Unable to restore tracee stack after writing shared memory name.");
+	}
+	if(is_syscall_error(tracee_fd)) {
+		throw tracer_exception("Unable to create shared memory in tracee: " + std::string(strerror(-tracee_fd)));
+	}
+	// The tracee's descriptor is reachable through procfs for us to map.
+	const std::string path = "/proc/" + std::to_string(tracee.process_id) + "/fd/" + std::to_string(tracee_fd);
+	int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+	if(fd == -1 || ftruncate(fd, length) != 0) {
+		const int error = errno;
+		if(fd != -1) {
+			close(fd);
+		}
+		inject_syscall(__NR_close, { tracee_fd });
+		throw tracer_exception("Unable to set up shared memory " + path + ": " + std::string(strerror(error)));
+	}
+	const long remote = inject_syscall(__NR_mmap, { 0, (long)length, PROT_READ | PROT_WRITE, MAP_SHARED, tracee_fd, 0 });
+	inject_syscall(__NR_close, { tracee_fd });
+	if(is_syscall_error(remote)) {
+		close(fd);
+		throw tracer_exception("Unable to map shared memory in tracee: " + std::string(strerror(-remote)));
+	}
+	void *local = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	const int error = errno;
+	close(fd);
+	if(local == MAP_FAILED) {
+		inject_syscall(__NR_munmap, { remote, (long)length });
+		throw tracer_exception("Unable to map shared memory in tracer: " + std::string(strerror(error)));
+	}
+	tracee.shared_memory = std::make_shared<struct shared_mapping>(local, (void *)remote, length);
+	return local;
+}
+
+void tracer::unmap_shared_memory() {
+	tracer_ensure_invariants();
+	if(!tracee.shared_memory) {
+		return;
+	}
+	if(tracee.stop_reason == SYSCALL_ENTRY) {
+		inject_syscall(__NR_munmap, { (long)tracee.shared_memory->remote, (long)tracee.shared_memory->length });
+	}
+	tracee.shared_memory.reset();
+}
+
+void tracer::_reestablish_shared_memory(uintptr_t inherited, size_t length) {
+	/* A forked child inherited the parent's region at the same address,
+	   backed by the same pages. Replace it with a region of its own, at
+	   its first stop, right after returning from the fork: have it enter
+	   getpid through the fork's system call instruction, inject there,
+	   and return to where it was. */
+	const enum stop_reason first_stop = tracee.stop_reason;
+	const int first_status = tracee.status;
+	const struct user_regs_struct returned_registers = read_registers();
+	std::vector<int> pending_signals;
+	_rewind_syscall(__NR_getpid);
+	if(!_resume_and_wait_keeping_signals(SYSCALL_ENTRY, pending_signals)) {
+		throw tracer_exception("Child exited before getting its own shared memory.");
+	}
+	inject_syscall(__NR_munmap, { (long)inherited, (long)length });
+	map_shared_memory(length);
+	if(!_resume_and_wait_keeping_signals(SYSCALL_EXIT, pending_signals)) {
+		throw tracer_exception("Child exited before getting its own shared memory.");
+	}
+	write_registers(returned_registers);
+	// Report the first stop as it was; resuming from here does the same.
+	tracee.stop_reason = first_stop;
+	tracee.status = first_status;
+	tracee.in_syscall = false;
+	_reraise_signals(pending_signals);
+}
@@ -8,7 +8,12 @@ enum stop_reason stop_reason_for_wait_status(int status, bool in_syscall) {
 	} else if(WIFSIGNALED(status)) {  // process terminated by unhandled signal
 		return EXITED;
 	} else if(WIFSTOPPED(status)) {
-		if(WSTOPSIG(status) == (SIGTRAP | 0x80)) {  // Syscall Stop
+		if((status >> 16) == PTRACE_EVENT_STOP) {
+			/* From man ptrace, PTRACE_EVENT_STOP: its stop signal may
+			   be SIGTRAP, or SIGSTOP, SIGTSTP, SIGTTIN or SIGTTOU for
+			   a group-stop, so check the event first. */
+			return INTERRUPTED;
+		} else if(WSTOPSIG(status) == (SIGTRAP | 0x80)) {  // Syscall Stop
 			/* from man syscall, section "Syscall-stops":
 			   That is, signal-delivery-stop never happens between 
 			   syscall-enter-stop and syscall-exit-stop; it happens 
@@ -30,6 +35,8 @@ enum stop_reason stop_reason_for_wait_status(int status, bool in_syscall) {
 					   PTRACE_EVENT_STOP if PTRACE_SEIZE 
 					   was used. */
 					return FORKED;
+				case PTRACE_EVENT_SECCOMP:
+					return SECCOMP;
 				default:
 					return NOT_STOPPED;
 			}
@@ -46,6 +53,8 @@ enum stop_reason stop_reason_for_ptrace_request(enum __ptrace_request request, b
 			return STEPPED;
 		case PTRACE_SYSCALL:
 			return (in_syscall ? SYSCALL_EXIT : SYSCALL_ENTRY);
+		case PTRACE_SYSEMU:
+			return EMULATED_SYSCALL;
 		case PTRACE_CONT:
 			return SIGNALED;
 		default:
@@ -60,8 +69,13 @@ enum __ptrace_request ptrace_request_for_stop_reason(enum stop_reason until) {
 		case SYSCALL_ENTRY:
 		case SYSCALL_EXIT:
 			return PTRACE_SYSCALL;
+		case EMULATED_SYSCALL:
+			return PTRACE_SYSEMU;
 		case SIGNALED:
 		case EXITED:
+		case SECCOMP:  // only filtered system calls stop the tracee
+		case FORKED:   // fork events stop the tracee whenever enabled
+		case INTERRUPTED:  // PTRACE_INTERRUPT stops the tracee under any request
 			return PTRACE_CONT;
 		case NOT_STOPPED:  // makes no sense
 		default:
@@ -81,21 +95,24 @@ bool operator<(enum stop_reason a, enum stop_reason b) {
 	      |
 	   STEPPED
 
-	          FORKED
-	            |
-	   SYSCALL_ENTRY / SYSCALL_EXIT
-	            |
-	        SIGNALED
-	            |
-	         STEPPED
+	      FORKED   SECCOMP   INTERRUPTED
+	           \      |      /
+	   SYSCALL_ENTRY / SYSCALL_EXIT / EMULATED_SYSCALL
+	                |
+	            SIGNALED
+	                |
+	             STEPPED
 	*/
 	switch(b) {
 		case EXITED:
 			return a == STEPPED;
 		case FORKED:
-			return a == SYSCALL_ENTRY || a == SYSCALL_EXIT || a == SIGNALED || a == STEPPED;
+		case SECCOMP:
+		case INTERRUPTED:
+			return a == SYSCALL_ENTRY || a == SYSCALL_EXIT || a == EMULATED_SYSCALL || a == SIGNALED || a == STEPPED;
 		case SYSCALL_ENTRY:
 		case SYSCALL_EXIT:
+		case EMULATED_SYSCALL:
 			return a == SIGNALED || a == STEPPED;
 		case SIGNALED:
 			return a == STEPPED;
@@ -0,0 +1,171 @@
+#include <sys/mman.h>   // MAP_ANONYMOUS, MAP_PRIVATE, MAP_TYPE
+#include <string>
+#include "syscall_replay.hpp"
+
+/* System calls that act on the tracee itself and are executed for real by
+   default. Names unknown on the calling architecture are skipped. */
+static const char *const default_passthrough[] = {
+	"brk", "mmap", "munmap", "mprotect", "mremap", "madvise",
+	"arch_prctl", "set_tid_address", "set_robust_list", "rseq", "prctl", "personality",
+	"rt_sigaction", "rt_sigprocmask", "rt_sigreturn", "sigaltstack",
+	"execve", "execveat", "exit", "exit_group",
+	"clone", "clone3", "fork", "vfork", "futex", "sched_yield",
+};
+
+static std::string syscall_description(long number) {
+	return std::string(tracer::syscall_name_by_number(number)) + " (" + std::to_string(number) + ")";
+}
+
+syscall_replayer::syscall_replayer(const trace_log_reader& log, pid_t recorded_thread)
+	: _next(log.begin()), _end(log.end()), _recorded_thread(recorded_thread),
+	  _passthrough(tracer::max_syscall_number() + 1)
+{
+	if(log.header().audit_architecture != tracer::audit_architecture()) {
+		throw tracer_exception("Cannot replay a trace log recorded on another architecture.");
+	}
+	if(_recorded_thread == -1 && _next != _end) {
+		_recorded_thread = _next->thread_id;
+	}
+	_skip_other_threads();
+	for(const char *name : default_passthrough) {
+		const long number = tracer::syscall_number_by_name(name);
+		if(number != -1) {
+			_passthrough[number] = true;
+		}
+	}
+}
+
+void syscall_replayer::set_passthrough(long number, bool enabled) {
+	if(number < 0 || number > tracer::max_syscall_number()) {
+		throw tracer_exception("No system call " + std::to_string(number) + " to pass through.");
+	}
+	_passthrough[number] = enabled;
+}
+
+bool syscall_replayer::passthrough(long number) const {
+	return (number >= 0 && number <= tracer::max_syscall_number() && _passthrough[number]);
+}
+
+void syscall_replayer::install(tracer& tracee) {
+	for(long number = 0; number <= tracer::max_syscall_number(); number++) {
+		if(_passthrough[number]) {
+			tracee.set_syscall_handler(number, tracer::syscall_handler());
+		} else {
+			tracee.set_syscall_handler(number, [this](tracer& tracee, long number, const long *) {
+				return _replay(tracee, number);
+			});
+		}
+	}
+}
+
+void syscall_replayer::uninstall(tracer& tracee) {
+	for(long number = 0; number <= tracer::max_syscall_number(); number++) {
+		tracee.set_syscall_handler(number, tracer::syscall_handler());
+	}
+}
+
+void syscall_replayer::_skip_other_threads() {
+	while(_next != _end && _next->thread_id != _recorded_thread) {
+		++_next;
+	}
+}
+
+const struct syscall_event& syscall_replayer::_expect(long number) {
+	if(_next == _end) {
+		throw tracer_exception("Replay ran past the end of the log at system call " + syscall_description(number) + ".");
+	}
+	const struct syscall_event& event = *_next;
+	if(event.syscall_number != number) {
+		throw tracer_exception("Replay diverged: tracee entered " + syscall_description(number)
+		                       + " where the log has " + syscall_description(event.syscall_number) + ".");
+	}
+	++_next;
+	_skip_other_threads();
+	return event;
+}
+
+void syscall_replayer::_write_captures(tracer& tracee, const struct syscall_event& event) {
+	const struct syscall_event_capture *capture = event.captures();
+	for(uint16_t i = 0; i < event.n_captures; i++, capture = capture->next()) {
+		if(capture->length > 0
+		   && tracee.write_memory((void *)capture->address, capture->data(), capture->length) != capture->length) {
+			throw tracer_exception("Unable to write back " + std::to_string(capture->length) + " bytes at "
+			                       + std::to_string(capture->address) + " for " + syscall_description(event.syscall_number) + ".");
+		}
+	}
+}
+
+/**
+ * @brief Whether `event` has memory captured through its return value, as
+ * for the contents of a file mapped by mmap.
+ */
+static bool has_return_value_capture(const struct syscall_event& event) {
+	const struct syscall_event_capture *capture = event.captures();
+	for(uint16_t i = 0; i < event.n_captures; i++, capture = capture->next()) {
+		if(capture->argument == syscall_event_return_value) {
+			return true;
+		}
+	}
+	return false;
+}
+
+long syscall_replayer::_replay(tracer& tracee, long number) {
+	const struct syscall_event& event = _expect(number);
+	if(!(event.flags & SYSCALL_EVENT_RETURNED)) {
+		throw tracer_exception("Cannot replay " + syscall_description(number) + ", which did not return during recording.");
+	}
+	if(event.flags & SYSCALL_EVENT_TRUNCATED) {
+		throw tracer_exception("Cannot replay " + syscall_description(number) + ", whose captures were truncated.");
+	}
+	_write_captures(tracee, event);
+	_events_replayed++;
+	return event.return_value;
+}
+
+bool syscall_replayer::syscall_passthrough(tracer& tracee) {
+	static const long mmap_number = tracer::syscall_number_by_name("mmap");
+	if(tracee.stop_reason() != EMULATED_SYSCALL) {
+		throw tracer_exception("System calls can only be passed through at an `EMULATED_SYSCALL` stop.");
+	}
+	const long number = tracee.get_syscall_number();
+	const struct syscall_event& event = _expect(number);
+	_events_passed_through++;
+	tracee.restart_syscall();
+	if(!tracee.resume_and_wait(SYSCALL_ENTRY)) {
+		return false;
+	}
+	const long flags = tracee.get_syscall_argument(3);
+	/* Mapped files are only recorded with `set_capture_mapped_files`;
+	   otherwise they are mapped for real. */
+	const bool file_mapping = (number == mmap_number && !(flags & MAP_ANONYMOUS) && (int)tracee.get_syscall_argument(4) >= 0
+	                           && has_return_value_capture(event));
+	if(file_mapping && (event.flags & SYSCALL_EVENT_TRUNCATED)) {
+		throw tracer_exception("Cannot replay " + syscall_description(number) + ", whose captures were truncated.");
+	}
+	if(file_mapping) {
+		// The file may not exist here; map memory to fill from the log.
+		tracee.set_syscall_argument(3, (flags & ~MAP_TYPE) | MAP_PRIVATE | MAP_ANONYMOUS);
+		tracee.set_syscall_argument(4, -1);
+		tracee.set_syscall_argument(5, 0);
+	}
+	if(!tracee.resume_and_wait(SYSCALL_EXIT)) {
+		return false;
+	}
+	const long return_value = tracee.get_syscall_return_value();
+	if((event.flags & SYSCALL_EVENT_RETURNED) && return_value != event.return_value
+	   && tracer::syscall_signature_by_number(number).return_kind == RETURN_POINTER) {
+		/* Later events refer to memory at the recorded addresses, so
+		   they must match. */
+		throw tracer_exception("Replay diverged: " + syscall_description(number) + " returned " + std::to_string(return_value)
+		                       + " where the log has " + std::to_string(event.return_value) + ".");
+	}
+	if(file_mapping) {
+		_write_captures(tracee, event);
+	}
+	if((event.flags & SYSCALL_EVENT_RETURNED) && return_value != event.return_value
+	   && tracer::syscall_signature_by_number(number).return_kind == RETURN_PID) {
+		// Replayed calls such as wait4 return the recorded process IDs.
+		tracee.set_syscall_return_value(event.return_value);
+	}
+	return true;
+}
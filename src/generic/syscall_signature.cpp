@@ -0,0 +1,86 @@
+#include <sys/stat.h>       // struct stat, struct statx
+#include <sys/statfs.h>     // struct statfs
+#include <sys/time.h>       // struct timeval, struct timezone, struct itimerval
+#include <sys/times.h>      // struct tms
+#include <sys/timex.h>      // struct timex
+#include <sys/resource.h>   // struct rlimit, struct rusage
+#include <sys/sysinfo.h>    // struct sysinfo
+#include <sys/utsname.h>    // struct utsname
+#include <sys/uio.h>        // struct iovec
+#include <sys/socket.h>     // struct sockaddr_storage, struct msghdr, struct mmsghdr
+#include <sys/select.h>     // fd_set
+#include <sys/epoll.h>      // struct epoll_event
+#include <sys/sem.h>        // struct sembuf
+#include <sys/msg.h>        // struct msqid_ds
+#include <sys/shm.h>        // struct shmid_ds
+#include <poll.h>           // struct pollfd
+#include <signal.h>         // siginfo_t, struct sigevent, stack_t
+#include <sched.h>          // struct sched_param
+#include <utime.h>          // struct utimbuf
+#include <mqueue.h>         // struct mq_attr
+#include <fcntl.h>          // struct file_handle
+#include <time.h>           // struct timespec, struct itimerspec
+#include <asm/ldt.h>        // struct user_desc
+#include <linux/capability.h> // struct __user_cap_header_struct
+#include <linux/aio_abi.h>  // struct io_event, struct iocb
+#include <linux/io_uring.h> // struct io_uring_params
+#include <linux/futex.h>    // struct robust_list_head, struct futex_waitv
+#include <linux/rseq.h>     // struct rseq
+#include <linux/perf_event.h> // struct perf_event_attr
+#include <linux/sched.h>    // struct clone_args
+#include <linux/openat2.h>  // struct open_how
+#include <linux/landlock.h> // struct landlock_ruleset_attr
+#include "syscall_signature.hpp"
+
+size_t syscall_struct_size(enum syscall_struct_type type) {
+	switch(type) {
+		case SYSCALL_STRUCT_STAT: return sizeof(struct stat);
+		case SYSCALL_STRUCT_STATX: return sizeof(struct statx);
+		case SYSCALL_STRUCT_STATFS: return sizeof(struct statfs);
+		case SYSCALL_STRUCT_TIMESPEC: return sizeof(struct timespec);
+		case SYSCALL_STRUCT_TIMEVAL: return sizeof(struct timeval);
+		case SYSCALL_STRUCT_TIMEZONE: return sizeof(struct timezone);
+		case SYSCALL_STRUCT_ITIMERSPEC: return sizeof(struct itimerspec);
+		case SYSCALL_STRUCT_ITIMERVAL: return sizeof(struct itimerval);
+		case SYSCALL_STRUCT_TIMEX: return sizeof(struct timex);
+		case SYSCALL_STRUCT_UTIMBUF: return sizeof(struct utimbuf);
+		case SYSCALL_STRUCT_TMS: return sizeof(struct tms);
+		case SYSCALL_STRUCT_RLIMIT: return sizeof(struct rlimit);
+		case SYSCALL_STRUCT_RUSAGE: return sizeof(struct rusage);
+		case SYSCALL_STRUCT_SYSINFO: return sizeof(struct sysinfo);
+		case SYSCALL_STRUCT_UTSNAME: return sizeof(struct utsname);
+		// The kernel's, not glibc's: handler, flags, restorer and a 64-bit mask.
+		case SYSCALL_STRUCT_SIGACTION: return 3 * sizeof(long) + 8;
+		case SYSCALL_STRUCT_SIGSET: return 8;
+		case SYSCALL_STRUCT_SIGINFO: return sizeof(siginfo_t);
+		case SYSCALL_STRUCT_SIGEVENT: return sizeof(struct sigevent);
+		case SYSCALL_STRUCT_STACK: return sizeof(stack_t);
+		case SYSCALL_STRUCT_POLLFD: return sizeof(struct pollfd);
+		case SYSCALL_STRUCT_FD_SET: return sizeof(fd_set);
+		case SYSCALL_STRUCT_EPOLL_EVENT: return sizeof(struct epoll_event);
+		case SYSCALL_STRUCT_IOVEC: return sizeof(struct iovec);
+		case SYSCALL_STRUCT_SOCKADDR: return sizeof(struct sockaddr_storage);
+		case SYSCALL_STRUCT_MSGHDR: return sizeof(struct msghdr);
+		case SYSCALL_STRUCT_MMSGHDR: return sizeof(struct mmsghdr);
+		case SYSCALL_STRUCT_SEMBUF: return sizeof(struct sembuf);
+		case SYSCALL_STRUCT_MSQID_DS: return sizeof(struct msqid_ds);
+		case SYSCALL_STRUCT_SHMID_DS: return sizeof(struct shmid_ds);
+		case SYSCALL_STRUCT_MQ_ATTR: return sizeof(struct mq_attr);
+		case SYSCALL_STRUCT_SCHED_PARAM: return sizeof(struct sched_param);
+		case SYSCALL_STRUCT_CAP_HEADER: return sizeof(struct __user_cap_header_struct);
+		case SYSCALL_STRUCT_USER_DESC: return sizeof(struct user_desc);
+		case SYSCALL_STRUCT_IO_EVENT: return sizeof(struct io_event);
+		case SYSCALL_STRUCT_IOCB: return sizeof(struct iocb);
+		case SYSCALL_STRUCT_IO_URING_PARAMS: return sizeof(struct io_uring_params);
+		case SYSCALL_STRUCT_ROBUST_LIST: return sizeof(struct robust_list_head);
+		case SYSCALL_STRUCT_FUTEX_WAITV: return sizeof(struct futex_waitv);
+		case SYSCALL_STRUCT_RSEQ: return sizeof(struct rseq);
+		case SYSCALL_STRUCT_PERF_EVENT_ATTR: return sizeof(struct perf_event_attr);
+		case SYSCALL_STRUCT_FILE_HANDLE: return sizeof(struct file_handle);
+		case SYSCALL_STRUCT_CLONE_ARGS: return sizeof(struct clone_args);
+		case SYSCALL_STRUCT_OPEN_HOW: return sizeof(struct open_how);
+		case SYSCALL_STRUCT_LANDLOCK_RULESET_ATTR: return sizeof(struct landlock_ruleset_attr);
+		// Versioned by the caller (cap_data, sched_attr, mount_attr), or obsolete (ustat).
+		default: return 0;
+	}
+}
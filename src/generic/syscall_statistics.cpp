@@ -0,0 +1,162 @@
+#include <time.h>       // clock_gettime
+#include <algorithm>    // std::max
+#include "syscall_statistics.hpp"
+
+static uint64_t monotonic_nanoseconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void count_error(struct syscall_totals& totals, int error, uint64_t count) {
+	for(struct syscall_errno_count& errno_count : totals.errors_by_errno) {
+		if(errno_count.error == error) {
+			errno_count.count += count;
+			return;
+		}
+	}
+	totals.errors_by_errno.push_back({ error, count });
+}
+
+static void add_totals(struct syscall_totals& to, const struct syscall_totals& from) {
+	to.calls += from.calls;
+	to.returns += from.returns;
+	to.errors += from.errors;
+	to.total_time += from.total_time;
+	to.max_time = std::max(to.max_time, from.max_time);
+	for(int i = 0; i < syscall_latency_buckets; i++) {
+		to.latency_histogram[i] += from.latency_histogram[i];
+	}
+	for(const struct syscall_errno_count& errno_count : from.errors_by_errno) {
+		count_error(to, errno_count.error, errno_count.count);
+	}
+}
+
+int syscall_statistics::latency_bucket(uint64_t nanoseconds) {
+	const int bucket = (nanoseconds == 0 ? 0 : 64 - __builtin_clzll(nanoseconds));
+	return (bucket < syscall_latency_buckets ? bucket : syscall_latency_buckets - 1);
+}
+
+uint64_t syscall_statistics::latency_bucket_end(int bucket) {
+	return (bucket >= syscall_latency_buckets - 1 ? UINT64_MAX : (uint64_t)1 << bucket);
+}
+
+uint64_t syscall_statistics::latency_quantile(const struct syscall_totals& totals, double quantile) {
+	const double wanted = quantile * totals.returns;
+	uint64_t seen = 0;
+	for(int i = 0; i < syscall_latency_buckets; i++) {
+		seen += totals.latency_histogram[i];
+		if(seen > 0 && seen >= wanted) {
+			return latency_bucket_end(i);
+		}
+	}
+	return 0;
+}
+
+struct syscall_totals& syscall_statistics::_totals(pid_t process, long number) {
+	std::vector<std::unique_ptr<struct syscall_totals>>& syscalls = _processes[process].syscalls;
+	if(syscalls.empty()) {
+		syscalls.resize(tracer::max_syscall_number() + 1);
+	}
+	if(!syscalls[number]) {
+		syscalls[number].reset(new struct syscall_totals());
+	}
+	return *syscalls[number];
+}
+
+void syscall_statistics::syscall_entry(tracer& tracee) {
+	const long number = tracee.get_syscall_number();
+	struct in_flight& current = _in_flight[tracee.process_id()];
+	if(number < 0 || number > tracer::max_syscall_number()) {
+		current.totals = NULL;
+		return;
+	}
+	current.totals = &_totals(tracee.thread_group_id(), number);
+	current.totals->calls++;
+	current.entry_time = monotonic_nanoseconds();
+}
+
+void syscall_statistics::syscall_exit(tracer& tracee) {
+	const uint64_t exit_time = monotonic_nanoseconds();
+	auto found = _in_flight.find(tracee.process_id());
+	if(found == _in_flight.end() || found->second.totals == NULL) {
+		// Entered before recording started, or not a known system call.
+		return;
+	}
+	struct syscall_totals& totals = *found->second.totals;
+	found->second.totals = NULL;
+	const uint64_t elapsed = exit_time - found->second.entry_time;
+	totals.returns++;
+	totals.total_time += elapsed;
+	totals.max_time = std::max(totals.max_time, elapsed);
+	totals.latency_histogram[latency_bucket(elapsed)]++;
+	const long return_value = tracee.get_syscall_return_value();
+	if(return_value < 0 && return_value >= -4095) {
+		totals.errors++;
+		count_error(totals, -return_value, 1);
+	}
+}
+
+void syscall_statistics::forget(pid_t thread) {
+	_in_flight.erase(thread);
+}
+
+void syscall_statistics::merge(const syscall_statistics& other) {
+	for(const auto& process : other._processes) {
+		for(size_t number = 0; number < process.second.syscalls.size(); number++) {
+			if(process.second.syscalls[number]) {
+				add_totals(_totals(process.first, number), *process.second.syscalls[number]);
+			}
+		}
+	}
+}
+
+void syscall_statistics::clear() {
+	_processes.clear();
+	_in_flight.clear();
+}
+
+std::vector<pid_t> syscall_statistics::processes() const {
+	std::vector<pid_t> processes;
+	for(const auto& process : _processes) {
+		processes.push_back(process.first);
+	}
+	return processes;
+}
+
+std::vector<long> syscall_statistics::syscalls() const {
+	std::vector<bool> seen(tracer::max_syscall_number() + 1);
+	for(const auto& process : _processes) {
+		for(size_t number = 0; number < process.second.syscalls.size(); number++) {
+			if(process.second.syscalls[number]) {
+				seen[number] = true;
+			}
+		}
+	}
+	std::vector<long> syscalls;
+	for(size_t number = 0; number < seen.size(); number++) {
+		if(seen[number]) {
+			syscalls.push_back(number);
+		}
+	}
+	return syscalls;
+}
+
+const struct syscall_totals *syscall_statistics::totals(pid_t process, long number) const {
+	auto found = _processes.find(process);
+	if(found == _processes.end() || number < 0 || (size_t)number >= found->second.syscalls.size()) {
+		return NULL;
+	}
+	return found->second.syscalls[number].get();
+}
+
+struct syscall_totals syscall_statistics::totals(long number) const {
+	struct syscall_totals sum = {};
+	for(const auto& process : _processes) {
+		const struct syscall_totals *totals = this->totals(process.first, number);
+		if(totals != NULL) {
+			add_totals(sum, *totals);
+		}
+	}
+	return sum;
+}
@@ -0,0 +1,345 @@
+#include <fcntl.h>      // open, O_CREAT
+#include <unistd.h>     // write, close
+#include <sys/mman.h>   // mmap, munmap, MAP_ANONYMOUS
+#include <sys/stat.h>   // fstat
+#include <sys/uio.h>    // struct iovec
+#include <sys/socket.h> // socklen_t
+#include <time.h>       // clock_gettime
+#include <algorithm>    // std::min
+#include <climits>      // IOV_MAX
+#include <cerrno>       // errno
+#include <cstring>      // memcpy, memcmp, strerror
+#include "trace_log.hpp"
+
+static const char trace_log_magic[8] = { 'T', 'R', 'A', 'C', 'E', 'L', 'O', 'G' };
+
+static const uint32_t trace_log_version = 1;
+
+static uint64_t nanoseconds(clockid_t clock) {
+	struct timespec now;
+	clock_gettime(clock, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static size_t padded(size_t length) {
+	return (length + 7) & ~(size_t)7;
+}
+
+trace_log_writer::trace_log_writer(const std::string& path, size_t buffer_size)
+	: _buffer(buffer_size)
+{
+	_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if(_fd == -1) {
+		throw tracer_exception("Unable to create trace log " + path + ": " + std::string(strerror(errno)));
+	}
+	struct trace_log_header header = {};
+	memcpy(header.magic, trace_log_magic, sizeof(header.magic));
+	header.version = trace_log_version;
+	header.audit_architecture = tracer::audit_architecture();
+	header.realtime_offset = nanoseconds(CLOCK_REALTIME) - nanoseconds(CLOCK_MONOTONIC);
+	_append(&header, sizeof(header));
+}
+
+trace_log_writer::~trace_log_writer() {
+	try {
+		close();
+	} catch(const tracer_exception&) {
+		// Nowhere to report it.
+	}
+}
+
+void trace_log_writer::_write_out(const char *data, size_t length) {
+	while(length > 0) {
+		const ssize_t written = ::write(_fd, data, length);
+		if(written == -1) {
+			if(errno == EINTR) {
+				continue;
+			}
+			throw tracer_exception("Unable to write trace log: " + std::string(strerror(errno)));
+		}
+		data += written;
+		length -= written;
+	}
+}
+
+void trace_log_writer::_append(const void *data, size_t length) {
+	if(_buffered + length > _buffer.size()) {
+		flush();
+		if(length > _buffer.size()) {
+			_write_out((const char *)data, length);
+			return;
+		}
+	}
+	memcpy(_buffer.data() + _buffered, data, length);
+	_buffered += length;
+}
+
+void trace_log_writer::flush() {
+	if(_fd == -1 || _buffered == 0) {
+		return;
+	}
+	_write_out(_buffer.data(), _buffered);
+	_buffered = 0;
+}
+
+void trace_log_writer::close() {
+	if(_fd == -1) {
+		return;
+	}
+	for(auto& pending : _pending) {
+		_write_pending(pending.second);
+	}
+	_pending.clear();
+	flush();
+	::close(_fd);
+	_fd = -1;
+}
+
+void trace_log_writer::write(const struct syscall_event& event, const char *captures, size_t captures_length, uint16_t n_captures) {
+	if(_fd == -1) {
+		throw tracer_exception("Cannot write to a closed trace log.");
+	}
+	if(captures_length > UINT32_MAX - sizeof(struct syscall_event)) {
+		throw tracer_exception("Event with " + std::to_string(captures_length) + " bytes of captures is too large for a trace log.");
+	}
+	struct syscall_event header = event;
+	header.size = sizeof(header) + captures_length;
+	header.n_captures = n_captures;
+	if(_buffered + header.size > _buffer.size()) {
+		flush();
+	}
+	_append(&header, sizeof(header));
+	if(captures_length > 0) {
+		_append(captures, captures_length);
+	}
+	_events_written++;
+}
+
+void trace_log_writer::_write_pending(struct pending_event& pending) {
+	write(pending.event, pending.captures.data(), pending.captures.size(), pending.n_captures);
+}
+
+void trace_log_writer::set_max_captures_length(size_t length) {
+	if(length > UINT32_MAX - sizeof(struct syscall_event)) {
+		throw tracer_exception("Captures of " + std::to_string(length) + " bytes do not fit a trace log event.");
+	}
+	_max_captures_length = length;
+}
+
+void trace_log_writer::syscall_entry(tracer& tracee) {
+	struct pending_event& pending = _pending[tracee.process_id()];
+	if(pending.event.entry_time != 0) {
+		// The previous call never returned, e.g. execve from another thread.
+		_write_pending(pending);
+	}
+	pending.event = {};
+	pending.captures.clear();
+	pending.n_captures = 0;
+	pending.event.process_id = tracee.thread_group_id();
+	pending.event.thread_id = tracee.process_id();
+	pending.event.syscall_number = tracee.get_syscall_number();
+	const int n_arguments = (tracer::n_syscall_arguments < syscall_event_max_arguments
+	                         ? tracer::n_syscall_arguments : syscall_event_max_arguments);
+	for(int i = 0; i < n_arguments; i++) {
+		pending.event.arguments[i] = tracee.get_syscall_argument(i);
+	}
+	/* Keep the capacities behind socklen_t pointers, which the kernel
+	   overwrites, to bound what `capture_outputs` takes at exit. */
+	const struct syscall_signature& signature = tracer::syscall_signature_by_number(pending.event.syscall_number);
+	for(int i = 0; i < signature.n_arguments && i < n_arguments; i++) {
+		pending.socklen_capacities[i] = 0;
+		if(signature.arguments[i].kind == ARGUMENT_SOCKLEN_INOUT && pending.event.arguments[i] != 0) {
+			tracee.read_memory((void *)pending.event.arguments[i], &pending.socklen_capacities[i], sizeof(socklen_t));
+		}
+	}
+	pending.event.entry_time = nanoseconds(CLOCK_MONOTONIC);
+}
+
+void trace_log_writer::capture(tracer& tracee, int argument, size_t length) {
+	auto found = _pending.find(tracee.process_id());
+	if(found == _pending.end() || found->second.event.entry_time == 0) {
+		throw tracer_exception("Cannot capture memory outside of a recorded system call.");
+	}
+	capture(tracee, argument, (uint64_t)found->second.event.arguments[argument], length);
+}
+
+void trace_log_writer::capture(tracer& tracee, int argument, uint64_t address, size_t length) {
+	auto found = _pending.find(tracee.process_id());
+	if(found == _pending.end() || found->second.event.entry_time == 0) {
+		throw tracer_exception("Cannot capture memory outside of a recorded system call.");
+	}
+	struct pending_event& pending = found->second;
+	std::vector<char>& captures = pending.captures;
+	const size_t start = captures.size();
+	if(pending.n_captures == UINT16_MAX || start + sizeof(struct syscall_event_capture) > _max_captures_length) {
+		pending.event.flags |= SYSCALL_EVENT_TRUNCATED;
+		return;
+	}
+	// Data is padded to 8 bytes, so only whole words of it fit.
+	const size_t room = (_max_captures_length - start - sizeof(struct syscall_event_capture)) & ~(size_t)7;
+	if(length > room) {
+		pending.event.flags |= SYSCALL_EVENT_TRUNCATED;
+		length = room;
+	}
+	captures.resize(start + sizeof(struct syscall_event_capture) + padded(length));
+	const size_t captured = (length == 0 || address == 0 ? 0 :
+	                         tracee.read_memory((void *)address, captures.data() + start + sizeof(struct syscall_event_capture), length));
+	captures.resize(start + sizeof(struct syscall_event_capture) + padded(captured));
+	struct syscall_event_capture *header = (struct syscall_event_capture *)(captures.data() + start);
+	header->argument = argument;
+	header->length = captured;
+	header->address = address;
+	pending.n_captures++;
+}
+
+/**
+ * @brief Bytes the kernel wrote through argument `i` of `event`, as far as
+ * its signature tells, given the `socklen_capacities` read at entry.
+ */
+static uint64_t output_length(tracer& tracee, const struct syscall_signature& signature, const struct syscall_event& event,
+                              const uint32_t socklen_capacities[], int i, uint64_t return_value) {
+	const struct syscall_argument_signature& argument = signature.arguments[i];
+	if(event.arguments[i] == 0) {
+		return 0;
+	}
+	const int length_argument = argument.length_argument;
+	uint64_t length = 0;  // The length argument, if any
+	bool from_socklen = false;
+	if(length_argument >= 0 && signature.arguments[length_argument].kind == ARGUMENT_SOCKLEN_INOUT) {
+		/* The kernel stores the full length of what it had to give, which
+		   may exceed the capacity it was given; it only wrote up to that. */
+		socklen_t written = 0;
+		if(event.arguments[length_argument] == 0
+		   || tracee.read_memory((void *)event.arguments[length_argument], &written, sizeof(written)) != sizeof(written)) {
+			return 0;
+		}
+		length = std::min((uint64_t)written, (uint64_t)socklen_capacities[length_argument]);
+		from_socklen = true;
+	} else if(length_argument >= 0) {
+		length = (uint64_t)event.arguments[length_argument];
+	}
+	const size_t struct_size = syscall_struct_size(argument.struct_type);
+	switch(argument.kind) {
+		case ARGUMENT_BUFFER_OUT:
+			// Buffers of read and the like are filled up to the returned length.
+			return (from_socklen ? length : std::min(length, return_value));
+		case ARGUMENT_STRUCT_OUT:
+		case ARGUMENT_STRUCT_INOUT:
+			if(length_argument < 0) {
+				// A sockaddr may be shorter than the largest one.
+				return (argument.struct_type == SYSCALL_STRUCT_SOCKADDR ? 0 : struct_size);
+			} else if(argument.struct_type == SYSCALL_STRUCT_SOCKADDR) {
+				return std::min(length, (uint64_t)struct_size);
+			} else if(argument.struct_type == SYSCALL_STRUCT_FD_SET) {
+				// Only the longs covering the first `length` descriptors.
+				const uint64_t bits = 8 * sizeof(long);
+				return std::min((length + bits - 1) / bits * sizeof(long), (uint64_t)struct_size);
+			} else if(argument.kind == ARGUMENT_STRUCT_OUT) {
+				// Arrays, e.g. of epoll_wait, up to the returned count.
+				return std::min(length, return_value) * struct_size;
+			}
+			// Arrays read and written back, e.g. pollfds, in full.
+			return length * struct_size;
+		case ARGUMENT_INT_OUT:
+			return argument.count * sizeof(int);
+		case ARGUMENT_SOCKLEN_INOUT:
+			return sizeof(socklen_t);
+		default:
+			return 0;
+	}
+}
+
+void trace_log_writer::capture_outputs(tracer& tracee) {
+	static const long mmap_number = tracer::syscall_number_by_name("mmap");
+	static const long readv_numbers[] = {
+		tracer::syscall_number_by_name("readv"),
+		tracer::syscall_number_by_name("preadv"),
+		tracer::syscall_number_by_name("preadv2"),
+	};
+	auto found = _pending.find(tracee.process_id());
+	if(found == _pending.end() || found->second.event.entry_time == 0) {
+		throw tracer_exception("Cannot capture memory outside of a recorded system call.");
+	}
+	const struct syscall_event& event = found->second.event;
+	const long return_value = tracee.get_syscall_return_value();
+	if(return_value < 0 && return_value >= -4095) {
+		return;
+	}
+	const struct syscall_signature& signature = tracer::syscall_signature_by_number(event.syscall_number);
+	for(int i = 0; i < signature.n_arguments && i < syscall_event_max_arguments; i++) {
+		const uint64_t length = output_length(tracee, signature, event, found->second.socklen_capacities, i, return_value);
+		if(length > 0) {
+			capture(tracee, i, length);
+		}
+	}
+	if(_capture_mapped_files && event.syscall_number == mmap_number
+	   && !(event.arguments[3] & MAP_ANONYMOUS) && (int)event.arguments[4] >= 0) {
+		capture(tracee, syscall_event_return_value, (uint64_t)return_value, event.arguments[1]);
+	}
+	for(long readv_number : readv_numbers) {
+		if(event.syscall_number != readv_number || readv_number == -1) {
+			continue;
+		}
+		std::vector<struct iovec> iovecs(std::min((uint64_t)event.arguments[2], (uint64_t)IOV_MAX));
+		const size_t n_iovecs = tracee.read_memory((void *)event.arguments[1], iovecs.data(),
+		                                           iovecs.size() * sizeof(struct iovec)) / sizeof(struct iovec);
+		uint64_t left = return_value;
+		for(size_t j = 0; j < n_iovecs && left > 0; j++) {
+			const uint64_t length = std::min((uint64_t)iovecs[j].iov_len, left);
+			capture(tracee, 1, (uint64_t)iovecs[j].iov_base, length);
+			left -= length;
+		}
+	}
+}
+
+void trace_log_writer::syscall_exit(tracer& tracee) {
+	auto found = _pending.find(tracee.process_id());
+	if(found == _pending.end() || found->second.event.entry_time == 0) {
+		// Entered before recording started.
+		return;
+	}
+	struct pending_event& pending = found->second;
+	pending.event.return_value = tracee.get_syscall_return_value();
+	pending.event.exit_time = nanoseconds(CLOCK_MONOTONIC);
+	pending.event.flags |= SYSCALL_EVENT_RETURNED;
+	_write_pending(pending);
+	pending.event.entry_time = 0;
+	pending.captures.clear();
+	pending.n_captures = 0;
+}
+
+trace_log_reader::trace_log_reader(const std::string& path) {
+	const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd == -1) {
+		throw tracer_exception("Unable to open trace log " + path + ": " + std::string(strerror(errno)));
+	}
+	struct stat status;
+	if(fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(struct trace_log_header)) {
+		::close(fd);
+		throw tracer_exception("Not a trace log: " + path);
+	}
+	_length = status.st_size;
+	void *mapped = mmap(NULL, _length, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(mapped == MAP_FAILED) {
+		throw tracer_exception("Unable to map trace log " + path + ": " + std::string(strerror(errno)));
+	}
+	_data = (const char *)mapped;
+	if(memcmp(header().magic, trace_log_magic, sizeof(trace_log_magic)) != 0 || header().version != trace_log_version) {
+		munmap((void *)_data, _length);
+		throw tracer_exception("Not a trace log of version " + std::to_string(trace_log_version) + ": " + path);
+	}
+	madvise((void *)_data, _length, MADV_SEQUENTIAL);
+}
+
+trace_log_reader::~trace_log_reader() {
+	munmap((void *)_data, _length);
+}
+
+trace_log_reader::iterator trace_log_reader::begin() const {
+	return iterator(_data + sizeof(struct trace_log_header), _data + _length);
+}
+
+trace_log_reader::iterator trace_log_reader::end() const {
+	return iterator(_data + _length, _data + _length);
+}
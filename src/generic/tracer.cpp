@@ -2,10 +2,58 @@
 #include <sys/wait.h>   // waitpid
 #include <sys/signal.h> // kill, SIGSTOP
 #include <sys/ptrace.h> // enum __ptrace_request
+#include <sys/prctl.h>  // prctl, PR_SET_NO_NEW_PRIVS
+#include <sys/syscall.h> // __NR_seccomp, SYS_kcmp
+#include <linux/filter.h>  // struct sock_filter, BPF_STMT
+#include <linux/seccomp.h> // SECCOMP_RET_TRACE, struct seccomp_data
+#include <linux/kcmp.h>    // KCMP_VM
+#include <algorithm>    // std::max
+#include <cstddef>      // offsetof
 #include <cerrno>       // errno
-#include <cstring>      // strerror
+#include <cstring>      // strerror, strncmp, strlen, strnlen
+#include <fstream>      // std::ifstream
 #include <vector> 
 #include "tracer.hpp"
+#include "tracer_counters.hpp"
+#include "tracer_registry.hpp"
+#include "tracer_session.hpp"
+
+/**
+ * @brief Numeric `field` (e.g. "Tgid:") of /proc/<thread_id>/status; -1 if
+ * it cannot be determined.
+ */
+static pid_t status_field_of(pid_t thread_id, const std::string& field) {
+	std::ifstream status("/proc/" + std::to_string(thread_id) + "/status");
+	std::string line;
+	while(std::getline(status, line)) {
+		if(line.compare(0, field.size(), field) == 0) {
+			return std::stoi(line.substr(field.size()));
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Thread group (i.e. process) id of thread `thread_id`, as reported
+ * by /proc; -1 if it cannot be determined.
+ */
+static pid_t thread_group_id_of(pid_t thread_id) {
+	return status_field_of(thread_id, "Tgid:");
+}
+
+/**
+ * @brief Whether two processes share their address space, as after vfork
+ * or clone with CLONE_VM. Without kcmp, only `vforked` children are known
+ * to.
+ */
+static bool shares_address_space(pid_t a, pid_t b, bool vforked) {
+	const long same = syscall(SYS_kcmp, a, b, KCMP_VM, 0, 0);
+	return (same == -1 ? vforked : same == 0);
+}
+
+/* Upper bound on n_syscall_arguments across supported architectures, for
+   stack buffers in architecture-independent code. */
+static const int max_syscall_arguments = 8;
 
 tracer::tracer()
 {
@@ -14,18 +62,30 @@ tracer::tracer()
 tracer::tracer(pid_t pid)
 {
 	tracee.process_id = pid;
+	tracee.thread_group_id = thread_group_id_of(pid);
 }
 
-void tracer::_set_options(bool trace_children) {
+long tracer::_ptrace_options() const {
 	long ptrace_options = 0;
 	//ptrace_options |= PTRACE_O_EXITKILL;
 	ptrace_options |= PTRACE_O_TRACESYSGOOD;
-	if(trace_children) {
+	ptrace_options |= PTRACE_O_TRACEEXEC;
+	if(_settings.trace_seccomp) {
+		ptrace_options |= PTRACE_O_TRACESECCOMP;
+	}
+	if(_settings.trace_children) {
 	       ptrace_options |= PTRACE_O_TRACEFORK;
 	       ptrace_options |= PTRACE_O_TRACEVFORK;
+	}
+	if(_settings.trace_threads) {
 	       ptrace_options |= PTRACE_O_TRACECLONE;
 	}
-	if(ptrace(PTRACE_SETOPTIONS, tracee.process_id, 0, ptrace_options) != 0) {
+	return ptrace_options;
+}
+
+void tracer::_set_options() {
+	TRACER_COUNT_PTRACE(PTRACE_SETOPTIONS);
+	if(ptrace(PTRACE_SETOPTIONS, tracee.process_id, 0, _ptrace_options()) != 0) {
 		throw tracer_exception("could not set ptrace options: " + std::to_string(errno) + " " + std::string(strerror(errno)));
 	}
 }
@@ -36,13 +96,104 @@ void tracer::_handle_fork() {
 	if(tracee.stop_reason != FORKED) {
 		throw tracer_exception("handle_fork may only be called with tracee stopped immediately after a fork.");
 	}
-	pid_t spawned_process_id = -1;
+	unsigned long spawned_process_id = 0;
+	TRACER_COUNT_PTRACE(PTRACE_GETEVENTMSG);
 	if(ptrace(PTRACE_GETEVENTMSG, tracee.process_id, 0, &spawned_process_id) == -1) {
 		throw tracer_exception("Unable to obtain forked child process id: " + std::string(strerror(errno)));
 	}
-	_children.emplace_back(spawned_process_id);
-	tracer& child_tracer = _children.back();
-	child_tracer._await_sigstop();
+	// Only clone events can create threads; they also cover unusual process clones.
+	const bool cloned = ((tracee.status >> 16) == PTRACE_EVENT_CLONE);
+	const pid_t spawned_thread_group_id = (cloned ? thread_group_id_of(spawned_process_id) : (pid_t)spawned_process_id);
+	const bool is_thread = (spawned_thread_group_id == tracee.thread_group_id);
+	const bool shares_memory = (is_thread || shares_address_space(tracee.process_id, spawned_process_id,
+	                                                             (tracee.status >> 16) == PTRACE_EVENT_VFORK));
+	if(_registry == NULL) {
+		_owned_registry = std::make_shared<tracer_registry>();
+		_registry = _owned_registry.get();
+	}
+	if(_children.size() >= 2 * std::max(_children_kept, (size_t)8)) {
+		// Amortized over the forks that grew the list since the last time.
+		_release_finished_children();
+	}
+	const tracer_handle child_handle = _registry->_add();
+	_children.push_back(child_handle);
+	tracer& child_tracer = *_registry->get(child_handle);
+	child_tracer.tracee.process_id = spawned_process_id;
+	child_tracer.tracee.thread_group_id = spawned_thread_group_id;
+	child_tracer.tracee.seized = tracee.seized;
+	child_tracer._settings = _settings;
+	if(shares_memory) {
+		// Same address space: a thread, a vfork child, or a clone with CLONE_VM.
+		child_tracer.tracee.memory_file = tracee.memory_file;
+		child_tracer.tracee.shared_memory = tracee.shared_memory;
+	}
+	child_tracer._session = _session;
+	_registry->_index(child_tracer);
+	if(child_tracer.tracee.seized) {
+		// From man ptrace: children of seized tracees start with PTRACE_EVENT_STOP.
+		child_tracer._await_interrupt();
+	} else {
+		child_tracer._await_sigstop();
+	}
+	if(!shares_memory && tracee.shared_memory) {
+		// The child shares our region's pages; give it its own first.
+		child_tracer._reestablish_shared_memory((uintptr_t)tracee.shared_memory->remote, tracee.shared_memory->length);
+	}
+	if(_session != NULL) {
+		_session->_adopt(child_tracer);
+	}
+}
+
+void tracer::_release_finished_children() {
+	std::vector<tracer_handle> kept;
+	for(size_t i = 0; i < _children.size(); i++) {
+		tracer *child_tracer = _registry->get(_children[i]);
+		if(child_tracer == NULL) {
+			continue;  // Released by a session
+		}
+		if(_session != NULL || _registry->find(child_tracer->tracee.process_id) == child_tracer) {
+			kept.push_back(_children[i]);
+			continue;
+		}
+		// Exited or detached. Its children are now ours to release.
+		_children.insert(_children.end(), child_tracer->_children.begin(), child_tracer->_children.end());
+		_registry->release(_children[i]);
+	}
+	_children.swap(kept);
+	_children_kept = _children.size();
+}
+
+void tracer::_handle_exec() {
+	// The old address space is gone, and everything referring to it.
+	tracee.memory_file.reset();
+	tracee.shared_memory.reset();
+	unsigned long former_thread_id = 0;
+	TRACER_COUNT_PTRACE(PTRACE_GETEVENTMSG);
+	if(ptrace(PTRACE_GETEVENTMSG, tracee.process_id, 0, &former_thread_id) == 0
+	   && former_thread_id != 0 && (pid_t)former_thread_id != tracee.process_id) {
+		_take_over_thread(former_thread_id);
+	}
+}
+
+void tracer::_take_over_thread(pid_t former_thread_id) {
+	/* From man ptrace, execve(2) under ptrace: when a thread other than
+	   the leader execs, all other threads die, and the execing thread
+	   takes over the leader's thread id. Its former id disappears
+	   without any notification. Pick up where its tracer left off. */
+	tracer *former = (_registry != NULL ? _registry->find(former_thread_id) : NULL);
+	if(former == NULL) {
+		return;
+	}
+	tracee.in_syscall = former->tracee.in_syscall;
+	tracee.last_request = former->tracee.last_request;
+	former->tracee.stop_reason = EXITED;
+	former->tracee.status = 0;
+	former->tracee.memory_file.reset();
+	former->tracee.shared_memory.reset();
+	_registry->_unindex(*former);
+	if(_session != NULL) {
+		_session->_vanish(*former);
+	}
 }
 
 void tracer::_await_sigstop() {
@@ -70,12 +221,36 @@ void tracer::_await_sigstop() {
 	} while(WSTOPSIG(tracee.status) != SIGSTOP);
 	// Reinject signals we observed waiting for our SIGSTOP.
 	for(int signal : pending_signals) {
-		kill(tracee.process_id, signal);
+		syscall(__NR_tgkill, tracee.thread_group_id, tracee.process_id, signal);
 	}
 	// After all this, tracee should be in SIGNALED stop state, having
 	// just received the raised SIGSTOP from above.
 }
 
+void tracer::_await_interrupt() {
+	tracer_ensure_invariants();
+	/* A seized tracee may report signal-delivery-stops before the
+	   PTRACE_EVENT_STOP; like in `_await_sigstop`, let them through and
+	   re-inject them once stopped. */
+	std::vector<int> pending_signals;
+	tracee.stop_reason = NOT_STOPPED;
+	while(true) {
+		enum stop_reason stop = wait();
+		if(stop == INTERRUPTED) {
+			break;
+		}
+		if(stop != SIGNALED) {
+			throw tracer_exception("Tracee stopped for unexpected reason " + std::to_string(stop) +
+			                       " (status " + std::to_string(tracee.status) + ") during seize.");
+		}
+		pending_signals.push_back(WSTOPSIG(tracee.status));
+		resume(INTERRUPTED);
+	}
+	for(int signal : pending_signals) {
+		syscall(__NR_tgkill, tracee.thread_group_id, tracee.process_id, signal);
+	}
+}
+
 
 pid_t tracer::fork() {
 	if(tracee.process_id != -1) {
@@ -92,20 +267,151 @@ pid_t tracer::fork() {
 		// Unreachable
 	} else {
 		tracee.process_id = child;
+		tracee.thread_group_id = child;
 		_await_sigstop();
-		_set_options(false);
+		_set_options();
 		return child;
 	}
 }
 
+pid_t tracer::fork(const std::vector<long>& traced_syscalls) {
+	_settings.trace_seccomp = true;
+	pid_t child = fork();
+	if(child == 0) {
+		/* Only install the filter now; the parent has set
+		   PTRACE_O_TRACESECCOMP while we were stopped. Without it, a
+		   filtered system call would fail with ENOSYS instead. */
+		_install_seccomp_filter(traced_syscalls);
+	}
+	return child;
+}
+
+void tracer::_install_seccomp_filter(const std::vector<long>& traced_syscalls) {
+	std::vector<struct sock_filter> program;
+	program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)));
+	program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, _audit_architecture, 1, 0));
+	program.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+	program.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)));
+	for(long number : traced_syscalls) {
+		// Pairs of compare/return keep all jump offsets short.
+		program.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t)number, 0, 1));
+		program.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_TRACE));
+	}
+	program.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+	struct sock_fprog filter {
+		(unsigned short)program.size(),
+		program.data()
+	};
+	if(prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0
+	   || syscall(__NR_seccomp, SECCOMP_SET_MODE_FILTER, 0, &filter) != 0) {
+		throw tracer_exception("Unable to install seccomp filter in child " + std::to_string(getpid()) +
+		                       ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
+	}
+}
+
 void tracer::attach(pid_t pid) {
+	TRACER_COUNT_PTRACE(PTRACE_ATTACH);
 	if(ptrace(PTRACE_ATTACH, pid, 0, 0) != 0) {
 		throw tracer_exception("Unable to attach to " + std::to_string(pid) + 
 		                       ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
 	}
-	_set_options(false);
 	tracee.process_id = pid;
+	tracee.thread_group_id = thread_group_id_of(pid);
 	_await_sigstop();
+	_set_options();
+}
+
+bool tracer::_seize(pid_t pid) {
+	if(tracee.process_id != -1) {
+		throw tracer_exception("Cannot seize; the tracer is already attached to a tracee.");
+	}
+	// Options are set atomically with the seize, so no clone can slip by.
+	TRACER_COUNT_PTRACE(PTRACE_SEIZE);
+	if(ptrace(PTRACE_SEIZE, pid, 0, _ptrace_options()) != 0) {
+		if(errno == ESRCH) {  // Exited in the meantime
+			return false;
+		}
+		if(errno == EPERM && status_field_of(pid, "TracerPid:") == (pid_t)syscall(__NR_gettid)) {
+			/* Already ours: auto-attached as the child of a seized
+			   tracee, with its fork event not handled yet. */
+			errno = EPERM;
+			return false;
+		}
+		throw tracer_exception("Unable to seize " + std::to_string(pid) +
+		                       ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
+	}
+	tracee.process_id = pid;
+	tracee.thread_group_id = thread_group_id_of(pid);
+	tracee.seized = true;
+	tracee.stop_reason = NOT_STOPPED;
+	/* Fails only if the thread is exiting, in which case `wait` will
+	   report its exit instead. */
+	TRACER_COUNT_PTRACE(PTRACE_INTERRUPT);
+	ptrace(PTRACE_INTERRUPT, pid, 0, 0);
+	return true;
+}
+
+void tracer::seize(pid_t pid) {
+	if(!_seize(pid)) {
+		throw tracer_exception("Unable to seize " + std::to_string(pid) +
+		                       ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
+	}
+	_await_interrupt();
+}
+
+void tracer::interrupt() {
+	if(!tracee.seized) {
+		throw tracer_exception("Only seized tracees can be interrupted.");
+	}
+	if(tracee.stop_reason != NOT_STOPPED) {
+		throw tracer_exception("Cannot `interrupt` a tracee that is already stopped.");
+	}
+	TRACER_COUNT_PTRACE(PTRACE_INTERRUPT);
+	if(ptrace(PTRACE_INTERRUPT, tracee.process_id, 0, 0) != 0) {
+		throw tracer_exception("Unable to interrupt " + std::to_string(tracee.process_id) +
+		                       ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
+	}
+}
+
+tracer *tracer::child(tracer_handle handle) const {
+	return (_registry == NULL ? NULL : _registry->get(handle));
+}
+
+void tracer::set_trace_children(bool enabled) {
+	_settings.trace_children = enabled;
+	if(tracee.process_id != -1 && tracee.stop_reason != EXITED) {
+		_set_options();
+	}
+}
+
+void tracer::set_trace_threads(bool enabled) {
+	_settings.trace_threads = enabled;
+	if(tracee.process_id != -1 && tracee.stop_reason != EXITED) {
+		_set_options();
+	}
+}
+
+void tracer::detach() {
+	tracer_ensure_invariants();
+	if(tracee.stop_reason == NOT_STOPPED) {
+		throw tracer_exception("Cannot `detach` from a tracee that is not currently stopped.");
+	}
+	if(tracee.stop_reason != EXITED) {
+		unmap_shared_memory();
+		flush();
+		TRACER_COUNT_PTRACE(PTRACE_DETACH);
+		if(ptrace(PTRACE_DETACH, tracee.process_id, 0, 0) != 0) {
+			throw tracer_exception("Unable to detach from " + std::to_string(tracee.process_id) +
+			                       ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
+		}
+	}
+	if(_session != NULL) {
+		_session->_forget(*this);
+	}
+	if(_registry != NULL) {
+		_registry->_unindex(*this);
+	}
+	tracee = {};
 }
 
 void tracer::resume(enum stop_reason until) {
@@ -117,45 +423,135 @@ void tracer::resume(enum stop_reason until) {
 		throw tracer_exception("`resume` can not be called with a `NOT_STOPPED` until argument.");
 	}
 	const enum __ptrace_request ptrace_request = ptrace_request_for_stop_reason(until);
+	if(tracee.in_syscall && ptrace_request != PTRACE_SYSCALL) {
+		/* From man ptrace, Syscall-stops: If after syscall-enter-stop,
+		   the tracer uses a restarting command other than
+		   PTRACE_SYSCALL, syscall-exit-stop is not generated. */
+		tracee.in_syscall = false;
+	}
+	_resume(ptrace_request);
+}
+
+void tracer::_resume(enum __ptrace_request request) {
+	flush();
 	tracee.registers_valid = false;
+	tracee.syscall_info_valid = false;
+	_invalidate_memory_cache();
 	tracee.stop_reason = NOT_STOPPED;
-	ptrace(ptrace_request, tracee.process_id, 0, 0);
+	tracee.last_request = request;
+	TRACER_COUNT_PTRACE(request);
+	ptrace(request, tracee.process_id, 0, 0);
 }
 
 enum stop_reason tracer::wait() {
+	return _wait(true);
+}
+
+enum stop_reason tracer::try_wait() {
+	return _wait(false);
+}
+
+enum stop_reason tracer::_wait(bool block) {
 	tracer_ensure_invariants();
 	if(tracee.stop_reason != NOT_STOPPED) {
 		throw tracer_exception("Cannot `wait` for a tracee that is already stopped.");
 	}
 	int status = 0;
-	int wait_return = -1;
-	do {  // Retry `waitpid` if interrupted by signal
-		wait_return = waitpid(tracee.process_id, &status, 0);
-	} while(wait_return != tracee.process_id && errno == EINTR);
-	if(wait_return != tracee.process_id) {
-		// Must be either ECHILD or EINVAL
-		if(errno == ECHILD) {
-			if(tracee.stop_reason != EXITED) {
-				throw tracer_exception("No tracee " + std::to_string(tracee.process_id) + ", or not a "
-				                       "child of this process, and no exit of tracee was observed "
-						       "through tracer class.");
-			} else {
-				return EXITED;
+	do {
+		if(_session != NULL && _session->_take_unclaimed_status(tracee.process_id, status)) {
+			// The session already reaped this status while waiting for any tracee.
+			continue;
+		}
+		int wait_return = -1;
+		struct rusage usage;
+		do {  // Retry `waitpid` if interrupted by signal
+			wait_return = tracer_wait(tracee.process_id, &status, __WALL | (block ? 0 : WNOHANG), &usage);
+		} while(wait_return == -1 && errno == EINTR);
+		if(wait_return == 0) {  // WNOHANG, and still running
+			return NOT_STOPPED;
+		}
+		if(wait_return != tracee.process_id) {
+			// Must be either ECHILD or EINVAL
+			if(errno == ECHILD) {
+				if(tracee.process_id != tracee.thread_group_id && tracee.thread_group_id != -1) {
+					/* A thread only vanishes without an exit status when
+					   another thread of its group calls execve. */
+					tracee.stop_reason = EXITED;
+					tracee.status = 0;
+					if(_registry != NULL) {
+						_registry->_unindex(*this);
+					}
+					return EXITED;
+				}
+				if(tracee.stop_reason != EXITED) {
+					throw tracer_exception("No tracee " + std::to_string(tracee.process_id) + ", or not a "
+					                       "child of this process, and no exit of tracee was observed "
+							       "through tracer class.");
+				} else {
+					return EXITED;
+				}
 			}
+			throw tracer_exception("waitpid returned unexpected error " + std::string(strerror(errno)));
 		}
-		throw tracer_exception("waitpid returned unexpected error " + std::string(strerror(errno)));
+		TRACER_COUNT_USAGE(tracee.process_id, tracee.thread_group_id, usage, status);
+	} while(_handle_wait_status(status) == NOT_STOPPED);
+	return tracee.stop_reason;
+}
+
+enum stop_reason tracer::_handle_wait_status(int status) {
+	if(WIFSTOPPED(status) && (status >> 16) == PTRACE_EVENT_EXEC) {
+		/* Exec stops are not surfaced as a stop reason; we only need
+		   them to drop state tied to the old address space. The tracee
+		   is resumed the same way it was before. */
+		_handle_exec();
+		_resume(tracee.last_request);
+		return NOT_STOPPED;
 	}
-	const enum stop_reason stop_reason = stop_reason_for_wait_status(status, tracee.in_syscall);
+	enum stop_reason stop_reason = stop_reason_for_wait_status(status, tracee.in_syscall);
 	if(stop_reason == NOT_STOPPED) {
 		throw tracer_exception("Unknown/unhandled stop reason: " + std::to_string(status));
 	}
+	if((stop_reason == SYSCALL_ENTRY || stop_reason == SYSCALL_EXIT) && tracee.last_request == PTRACE_SYSEMU) {
+		// PTRACE_SYSEMU only ever reports entries; there is no exit to pair.
+		stop_reason = EMULATED_SYSCALL;
+	}
 	tracee.status = status;
 	tracee.stop_reason = stop_reason;
-	if(tracee.stop_reason == SYSCALL_ENTRY || tracee.stop_reason == SYSCALL_EXIT) {
+	if(tracee.stop_reason == EMULATED_SYSCALL) {
+		/* Resuming with PTRACE_SYSCALL from here still reports an exit
+		   stop for the skipped call, just as after a seccomp stop. */
+		tracee.in_syscall = true;
+		if(_emulate_syscall()) {
+			TRACER_COUNT_STOP(EMULATED_SYSCALL);
+			return NOT_STOPPED;
+		}
+	} else if((tracee.stop_reason == SYSCALL_ENTRY || tracee.stop_reason == SYSCALL_EXIT)
+	   && _settings.syscall_info_backend == SYSCALL_INFO_PTRACE) {
+		// The kernel knows which side of the system call we are on.
+		const struct __ptrace_syscall_info *info = _syscall_info();
+		if(info->op == PTRACE_SYSCALL_INFO_ENTRY) {
+			tracee.stop_reason = SYSCALL_ENTRY;
+		} else if(info->op == PTRACE_SYSCALL_INFO_EXIT) {
+			tracee.stop_reason = SYSCALL_EXIT;
+		}
+		tracee.in_syscall = (tracee.stop_reason == SYSCALL_ENTRY);
+	} else if(tracee.stop_reason == SYSCALL_ENTRY || tracee.stop_reason == SYSCALL_EXIT) {
 		tracee.in_syscall = !tracee.in_syscall;
+	} else if(tracee.stop_reason == SECCOMP) {
+		// The next syscall-stop, if requested, is the exit of this call.
+		tracee.in_syscall = true;
 	} else if(tracee.stop_reason == FORKED) {
+		// Stopped inside fork, vfork or clone; the next syscall-stop, if requested, is its exit.
+		tracee.in_syscall = true;
 		_handle_fork();
+	} else if(tracee.stop_reason == EXITED) {
+		tracee.memory_file.reset();
+		tracee.shared_memory.reset();
+		if(_registry != NULL) {
+			_registry->_unindex(*this);
+		}
 	}
+	TRACER_COUNT_STOP(tracee.stop_reason);
 	return tracee.stop_reason;
 }
 
@@ -172,11 +568,99 @@ bool tracer::resume_and_wait(enum stop_reason until, int intermediate_stops) {
 	return tracee.stop_reason == until;
 }
 
+void tracer::set_syscall_handler(long number, syscall_handler handler) {
+	if(handler) {
+		_settings.syscall_handlers[number] = handler;
+	} else {
+		_settings.syscall_handlers.erase(number);
+	}
+}
+
+bool tracer::_emulate_syscall() {
+	if(_settings.syscall_handlers.empty()) {
+		return false;
+	}
+	const long number = get_syscall_number();
+	const auto handler = _settings.syscall_handlers.find(number);
+	if(handler == _settings.syscall_handlers.end()) {
+		return false;
+	}
+	long arguments[max_syscall_arguments] = {};
+	for(int i = 0; i < n_syscall_arguments && i < max_syscall_arguments; i++) {
+		arguments[i] = get_syscall_argument(i);
+	}
+	set_syscall_return_value(handler->second(*this, number, arguments));
+	// Like `resume`; no exit stop follows the answered call.
+	tracee.in_syscall = false;
+	_resume(tracee.last_request);
+	return true;
+}
+
+void tracer::restart_syscall() {
+	tracer_ensure_invariants();
+	if(tracee.stop_reason != EMULATED_SYSCALL) {
+		throw tracer_exception("Only system calls at an `EMULATED_SYSCALL` stop can be restarted.");
+	}
+	_rewind_syscall(get_syscall_number());
+}
+
+long tracer::inject_syscall(long number, const std::vector<long>& arguments) {
+	tracer_ensure_invariants();
+	if(tracee.stop_reason != SYSCALL_ENTRY) {
+		throw tracer_exception("System calls can only be injected at a system call entry stop.");
+	}
+	if(arguments.size() > (size_t)n_syscall_arguments) {
+		throw tracer_exception("Too many arguments (" + std::to_string(arguments.size()) + ") for injected system call.");
+	}
+	std::vector<int> pending_signals;
+	const long original_number = get_syscall_number();
+	const struct user_regs_struct original_registers = read_registers();
+	set_syscall_number(number);
+	for(size_t i = 0; i < arguments.size(); i++) {
+		set_syscall_argument(i, arguments[i]);
+	}
+	if(!_resume_and_wait_keeping_signals(SYSCALL_EXIT, pending_signals)) {
+		throw tracer_exception("Tracee exited during injected system call " + std::to_string(number) + ".");
+	}
+	const long result = get_syscall_return_value();
+	/* Back up to the system call instruction with the original registers,
+	   and let the tracee enter the original system call once more. */
+	write_registers(original_registers);
+	_rewind_syscall(original_number);
+	if(!_resume_and_wait_keeping_signals(SYSCALL_ENTRY, pending_signals)) {
+		throw tracer_exception("Tracee exited while returning from injected system call " + std::to_string(number) + ".");
+	}
+	_reraise_signals(pending_signals);
+	return result;
+}
+
+bool tracer::_resume_and_wait_keeping_signals(enum stop_reason until, std::vector<int>& signals) {
+	/* Signals that arrive meanwhile stop the tracee on the way; like in
+	   `_await_sigstop`, let them through, to be re-injected once done, so
+	   that they are reported at the next resume as if nothing happened. */
+	do {
+		resume(until);
+		wait();
+		if(tracee.stop_reason == SIGNALED) {
+			signals.push_back(WSTOPSIG(tracee.status));
+		}
+	} while(tracee.stop_reason != until && tracee.stop_reason != EXITED);
+	return tracee.stop_reason == until;
+}
+
+void tracer::_reraise_signals(const std::vector<int>& signals) {
+	for(int signal : signals) {
+		syscall(__NR_tgkill, tracee.thread_group_id, tracee.process_id, signal);
+	}
+}
+
 const struct user_regs_struct& tracer::read_registers() {
 	tracer_ensure_invariants();
 	if(tracee.registers_valid) {
+		TRACER_COUNT(COUNTER_REGISTER_READS_CACHED, 1);
 		return tracee.registers;
 	}
+	TRACER_COUNT(COUNTER_REGISTER_READS, 1);
 	if(_read_registers_internal(tracee.process_id, tracee.registers) != 0) {
 		tracee.registers_valid = false;
 		throw tracer_exception("Could not read registers: " + std::string(strerror(errno)));
@@ -187,44 +671,188 @@ const struct user_regs_struct& tracer::read_registers() {
 
 void tracer::write_registers(const struct user_regs_struct& new_registers) {
 	tracer_ensure_invariants();
-	if(_write_registers_internal(tracee.process_id, new_registers) != 0) {
+	tracee.syscall_info_valid = false;
+	tracee.registers = new_registers;
+	tracee.registers_valid = true;
+	tracee.registers_dirty = true;
+	if(_settings.write_through_registers) {
+		flush();
+	}
+}
+
+void tracer::flush() {
+	if(!tracee.registers_dirty) {
+		return;
+	}
+	TRACER_COUNT(COUNTER_REGISTER_WRITES, 1);
+	if(_write_registers_internal(tracee.process_id, tracee.registers) != 0) {
 		tracee.registers_valid = false;
+		tracee.registers_dirty = false;
 		throw tracer_exception("Could not write registers: " + std::string(strerror(errno)));
 	}
-	tracee.registers = new_registers;
-	tracee.registers_valid = true;
+	tracee.registers_dirty = false;
+}
+
+const struct __ptrace_syscall_info *tracer::_syscall_info() {
+	if(_settings.syscall_info_backend != SYSCALL_INFO_PTRACE || tracee.registers_dirty) {
+		// The kernel's view would not include our pending register writes.
+		return NULL;
+	}
+	if(tracee.syscall_info_valid) {
+		return &tracee.syscall_info;
+	}
+	TRACER_COUNT_PTRACE(PTRACE_GET_SYSCALL_INFO);
+	if(ptrace(PTRACE_GET_SYSCALL_INFO, tracee.process_id, sizeof(tracee.syscall_info), &tracee.syscall_info) <= 0) {
+		throw tracer_exception("Could not get system call info: " + std::to_string(errno) + " " + std::string(strerror(errno)));
+	}
+	tracee.syscall_info_valid = true;
+	return &tracee.syscall_info;
+}
+
+/* In struct __ptrace_syscall_info, the seccomp member starts with the same
+   nr and args fields as the entry member. */
+
+long tracer::get_syscall_number() {
+	tracer_ensure_invariants();
+	const struct __ptrace_syscall_info *info = _syscall_info();
+	if(info != NULL && (info->op == PTRACE_SYSCALL_INFO_ENTRY || info->op == PTRACE_SYSCALL_INFO_SECCOMP)) {
+		return info->entry.nr;
+	}
+	return _read_syscall_number();
+}
+
+long tracer::get_syscall_argument(size_t i) {
+	tracer_ensure_invariants();
+	const struct __ptrace_syscall_info *info = _syscall_info();
+	if(info != NULL && i < 6 && (info->op == PTRACE_SYSCALL_INFO_ENTRY || info->op == PTRACE_SYSCALL_INFO_SECCOMP)) {
+		return info->entry.args[i];
+	}
+	return _read_syscall_argument(i);
+}
+
+long tracer::get_syscall_return_value() {
+	tracer_ensure_invariants();
+	const struct __ptrace_syscall_info *info = _syscall_info();
+	if(info != NULL && info->op == PTRACE_SYSCALL_INFO_EXIT) {
+		return info->exit.rval;
+	}
+	return _read_syscall_return_value();
+}
+
+long tracer::get_instruction_pointer() {
+	tracer_ensure_invariants();
+	const struct __ptrace_syscall_info *info = _syscall_info();
+	if(info != NULL) {
+		return info->instruction_pointer;
+	}
+	return _read_instruction_pointer();
+}
+
+long tracer::get_stack_pointer() {
+	tracer_ensure_invariants();
+	const struct __ptrace_syscall_info *info = _syscall_info();
+	if(info != NULL) {
+		return info->stack_pointer;
+	}
+	return _read_stack_pointer();
 }
 
 long tracer::read_word(void *offset) {
 	tracer_ensure_invariants();
+	long word = 0;
+	if(_read_memory_cached(offset, &word, sizeof(word)) == sizeof(word)) {
+		return word;
+	}
 	errno = 0;
+	TRACER_COUNT_PTRACE(PTRACE_PEEKDATA);
 	long ret = ptrace(PTRACE_PEEKDATA, tracee.process_id, offset, 0);
 	if(errno != 0) {
 		throw tracer_exception("Unable to peek data at " + std::to_string((long)offset) + ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
 	}
+	TRACER_COUNT(COUNTER_MEMORY_BYTES_READ, sizeof(long));
 	return ret;
 }
 
 void tracer::write_word(void *offset, long value) {
 	tracer_ensure_invariants();
+	_invalidate_memory_cache();
+	TRACER_COUNT_PTRACE(PTRACE_POKEDATA);
 	if(ptrace(PTRACE_POKEDATA, tracee.process_id, offset, value) != 0) {
 		throw tracer_exception("Unable to poke data at " + std::to_string((long)offset) + ": " + std::to_string(errno) + " " + std::string(strerror(errno)));
 	}
+	TRACER_COUNT(COUNTER_MEMORY_BYTES_WRITTEN, sizeof(long));
 }
 
-std::string tracer::get_syscall_name() {
+const char *tracer::get_syscall_name() {
 	tracer_ensure_invariants();
 	long number = get_syscall_number();
 	return syscall_name_by_number(number);
 }
 
-std::string tracer::syscall_name_by_number(long number, std::string default_name) {
-	if(number < 0 || number > max_syscall_number) {
+const struct syscall_signature& tracer::get_syscall_signature() {
+	tracer_ensure_invariants();
+	return syscall_signature_by_number(get_syscall_number());
+}
+
+const struct syscall_signature& tracer::syscall_signature_by_number(long number) {
+	static const struct syscall_signature unknown = {
+		false, 6, RETURN_INT, {
+			{ ARGUMENT_INT, -1, SYSCALL_STRUCT_NONE, 0 }, { ARGUMENT_INT, -1, SYSCALL_STRUCT_NONE, 0 },
+			{ ARGUMENT_INT, -1, SYSCALL_STRUCT_NONE, 0 }, { ARGUMENT_INT, -1, SYSCALL_STRUCT_NONE, 0 },
+			{ ARGUMENT_INT, -1, SYSCALL_STRUCT_NONE, 0 }, { ARGUMENT_INT, -1, SYSCALL_STRUCT_NONE, 0 },
+		}
+	};
+	if(number < 0 || number > _max_syscall_number) {
+		return unknown;
+	}
+	return syscall_signatures[number];
+}
+
+const char *tracer::syscall_name_by_number(long number, const char *default_name) {
+	if(number < 0 || number > _max_syscall_number) {
 		return default_name;
 	}
 	const char *out = syscall_names[number];
 	if(out == NULL) {
 		return default_name;
 	}
-	return std::string(out);
+	return out;
+}
+
+/**
+ * @brief Seeded FNV-1a. Must be kept in sync with syscall_name_hash in
+ * build_scripts/build_syscall_names_table.rb, which builds the hash table.
+ */
+static uint32_t syscall_name_hash(uint32_t seed, const char *name, size_t length) {
+	uint32_t hash = 0x811c9dc5 ^ seed;
+	for(size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+long tracer::syscall_number_by_name(const char *name, size_t length) {
+	/* No name in the table contains a NUL, and one in `name` would stop
+	   the comparison below short of `length`, before the end of the
+	   candidate it then looks past. */
+	if(syscall_hash_size == 0 || strnlen(name, length) != length) {
+		return -1;
+	}
+	const int32_t seed = syscall_hash_seeds[syscall_name_hash(0, name, length) % syscall_hash_size];
+	const size_t slot = (seed < 0 ? -seed - 1 : syscall_name_hash(seed, name, length) % syscall_hash_size);
+	const long number = syscall_hash_slots[slot];
+	if(number < 0 || number > _max_syscall_number || syscall_names[number] == NULL) {
+		return -1;
+	}
+	// Names not in the table hash to arbitrary slots; confirm the match.
+	const char *candidate = syscall_names[number];
+	if(strncmp(candidate, name, length) != 0 || candidate[length] != '\0') {
+		return -1;
+	}
+	return number;
+}
+
+long tracer::syscall_number_by_name(const char *name) {
+	return syscall_number_by_name(name, strlen(name));
 }
@@ -0,0 +1,188 @@
+#include <sys/resource.h> // getrusage
+#include <sys/wait.h>   // wait4
+#include <time.h>       // clock_gettime
+#include <cerrno>       // errno
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "tracer_counters.hpp"
+
+static constexpr const char *counter_names[] = {
+	"ptrace_resume",
+	"ptrace_get_registers",
+	"ptrace_set_registers",
+	"ptrace_get_syscall_info",
+	"ptrace_peek",
+	"ptrace_poke",
+	"ptrace_get_event_message",
+	"ptrace_set_options",
+	"ptrace_attach",
+	"ptrace_interrupt",
+	"ptrace_detach",
+	"ptrace_other",
+	"waits",
+	"wait_interruptions",
+	"wait_time_ns",
+	"stops_exited",
+	"stops_forked",
+	"stops_syscall_entry",
+	"stops_syscall_exit",
+	"stops_signaled",
+	"stops_stepped",
+	"stops_seccomp",
+	"stops_emulated_syscall",
+	"stops_interrupted",
+	"register_reads_cached",
+	"register_reads",
+	"register_writes",
+	"memory_bytes_read",
+	"memory_bytes_written",
+	"tracee_cpu_time_ns",
+};
+
+static constexpr bool names_equal(const char *a, const char *b) {
+	return (*a == *b && (*a == '\0' || names_equal(a + 1, b + 1)));
+}
+
+static_assert(sizeof(counter_names) / sizeof(counter_names[0]) == N_TRACER_COUNTERS,
+              "counter_names must name every tracer_counter.");
+// The names of the stop counters follow `enum stop_reason` up to NOT_STOPPED.
+static_assert(names_equal(counter_names[COUNTER_STOPS + EXITED], "stops_exited")
+              && names_equal(counter_names[COUNTER_STOPS + INTERRUPTED], "stops_interrupted")
+              && INTERRUPTED + 1 == NOT_STOPPED && COUNTER_STOPS_LAST == COUNTER_STOPS + INTERRUPTED,
+              "The stop counter names must match enum stop_reason.");
+
+const char *tracer_counter_name(enum tracer_counter counter) {
+	return (counter >= 0 && counter < N_TRACER_COUNTERS ? counter_names[counter] : "unknown");
+}
+
+#ifdef TRACER_COUNTERS
+
+static uint64_t nanoseconds(const struct timeval& time) {
+	return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_usec * 1000;
+}
+
+static uint64_t process_cpu_time() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return nanoseconds(usage.ru_utime) + nanoseconds(usage.ru_stime);
+}
+
+uint64_t tracer_counter_clock() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Blocks of live threads are registered here; a thread that ends adds its
+   counts to `retired`. Snapshots and resets take the mutex, counting does
+   not. */
+static std::mutex blocks_mutex;
+static std::vector<struct tracer_counter_block *> blocks;
+static uint64_t retired[N_TRACER_COUNTERS];
+static uint64_t reset_time = tracer_counter_clock();
+static uint64_t reset_cpu_time = process_cpu_time();
+
+namespace {
+
+struct thread_counters {
+	struct tracer_counter_block block;
+	std::unordered_map<pid_t, uint64_t> tracee_cpu_times;  // Last reported, by thread group id
+
+	thread_counters() {
+		for(std::atomic<uint64_t>& count : block.counts) {
+			count.store(0, std::memory_order_relaxed);
+		}
+		std::lock_guard<std::mutex> lock(blocks_mutex);
+		blocks.push_back(&block);
+	}
+
+	~thread_counters() {
+		std::lock_guard<std::mutex> lock(blocks_mutex);
+		for(int i = 0; i < N_TRACER_COUNTERS; i++) {
+			retired[i] += block.counts[i].load(std::memory_order_relaxed);
+		}
+		for(auto it = blocks.begin(); it != blocks.end(); ++it) {
+			if(*it == &block) {
+				blocks.erase(it);
+				break;
+			}
+		}
+	}
+};
+
+}
+
+static struct thread_counters& this_thread_counters() {
+	static thread_local struct thread_counters counters;
+	return counters;
+}
+
+struct tracer_counter_block& tracer_thread_counters() {
+	return this_thread_counters().block;
+}
+
+void tracer_count_tracee_usage(pid_t process, const struct rusage& usage, bool exited) {
+	std::unordered_map<pid_t, uint64_t>& cpu_times = this_thread_counters().tracee_cpu_times;
+	const uint64_t cpu_time = nanoseconds(usage.ru_utime) + nanoseconds(usage.ru_stime);
+	uint64_t& last = cpu_times[process];
+	if(cpu_time > last) {
+		tracer_count(COUNTER_TRACEE_CPU_TIME, cpu_time - last);
+		last = cpu_time;
+	}
+	if(exited) {
+		cpu_times.erase(process);
+	}
+}
+
+pid_t tracer_wait(pid_t pid, int *status, int options, struct rusage *usage) {
+	const uint64_t start = tracer_counter_clock();
+	const pid_t waited = wait4(pid, status, options, usage);
+	const int wait_errno = errno;
+	tracer_count(COUNTER_WAITS);
+	tracer_count(COUNTER_WAIT_TIME, tracer_counter_clock() - start);
+	if(waited == -1 && wait_errno == EINTR) {
+		tracer_count(COUNTER_WAIT_INTERRUPTIONS);
+	}
+	errno = wait_errno;
+	return waited;
+}
+
+struct tracer_counters tracer_counters_snapshot() {
+	struct tracer_counters snapshot = {};
+	snapshot.enabled = true;
+	std::lock_guard<std::mutex> lock(blocks_mutex);
+	for(int i = 0; i < N_TRACER_COUNTERS; i++) {
+		snapshot.counts[i] = retired[i];
+		for(struct tracer_counter_block *block : blocks) {
+			snapshot.counts[i] += block->counts[i].load(std::memory_order_relaxed);
+		}
+	}
+	snapshot.elapsed_time = tracer_counter_clock() - reset_time;
+	snapshot.tracer_cpu_time = process_cpu_time() - reset_cpu_time;
+	return snapshot;
+}
+
+void tracer_counters_reset() {
+	/* Counts belong to their thread and are only ever written by it, so
+	   rather than zeroing them, remember where they stood. */
+	struct tracer_counters current = tracer_counters_snapshot();
+	std::lock_guard<std::mutex> lock(blocks_mutex);
+	for(int i = 0; i < N_TRACER_COUNTERS; i++) {
+		retired[i] -= current.counts[i];
+	}
+	reset_time = tracer_counter_clock();
+	reset_cpu_time = process_cpu_time();
+}
+
+#else
+
+struct tracer_counters tracer_counters_snapshot() {
+	struct tracer_counters snapshot = {};
+	return snapshot;
+}
+
+void tracer_counters_reset() {
+}
+
+#endif
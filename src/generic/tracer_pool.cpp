@@ -0,0 +1,303 @@
+#include <unistd.h>     // _exit, getpid, STDERR_FILENO
+#include <sys/uio.h>    // writev, struct iovec
+#include <signal.h>     // sigaction, pthread_kill, SIGRTMIN
+#include <cstring>      // strlen
+#include <chrono>
+#include "tracer_pool.hpp"
+
+static void ignore_wake_signal(int)
+{
+}
+
+/* Called in a child forked by `spawn` with an exception in flight, from
+   `tracer::fork` failing to accept tracing or from `child_main`. Report it
+   and exit before it can unwind into the child's copy of the worker. */
+static void exit_spawned_child()
+{
+	try {
+		throw;
+	} catch(const std::exception& e) {
+		struct iovec message[2] = {
+			{ (void *)e.what(), strlen(e.what()) },
+			{ (void *)"\n", 1 },
+		};
+		writev(STDERR_FILENO, message, 2);
+	} catch(...) {
+	}
+	_exit(127);
+}
+
+int tracer_pool::wake_signal() {
+	return SIGRTMIN;
+}
+
+tracer_pool::tracer_pool(size_t workers, event_handler handler, size_t event_capacity,
+                         enum spsc_overflow_policy overflow)
+	: _handler(handler), _publish_events(event_capacity > 0), _stopping(false),
+	  _running_workers(workers), _consumer_waiting(false)
+{
+	if(workers == 0) {
+		throw tracer_exception("A tracer pool needs at least one worker.");
+	}
+	static std::once_flag installed;
+	std::call_once(installed, []() {
+		// No SA_RESTART: the signal must make a blocked waitpid return.
+		struct sigaction action = {};
+		action.sa_handler = ignore_wake_signal;
+		sigemptyset(&action.sa_mask);
+		sigaction(wake_signal(), &action, NULL);
+	});
+	for(size_t i = 0; i < workers; i++) {
+		_workers.emplace_back(new struct worker(i, event_capacity, overflow));
+	}
+	for(auto& worker : _workers) {
+		worker->thread = std::thread(&tracer_pool::_run, this, std::ref(*worker));
+		worker->native_thread = worker->thread.native_handle();
+	}
+}
+
+tracer_pool::~tracer_pool() {
+	shutdown();
+}
+
+void tracer_pool::_run(struct worker& worker) {
+	worker.session._this_thread_only = true;
+	worker.session._on_adopt = [this, &worker](tracer& adopted) {
+		std::lock_guard<std::mutex> lock(_owners_mutex);
+		_owners[adopted.process_id()] = worker.index;
+	};
+	struct tracer_event event;
+	while(true) {
+		_run_commands(worker);
+		while(worker.session._pop_event(event)) {
+			_handle(worker, event);
+		}
+		worker.tracees = worker.session.size();
+		if(worker.session.size() == 0) {
+			// Nothing to wait for but commands.
+			std::unique_lock<std::mutex> lock(worker.mutex);
+			if(worker.commands.empty()) {
+				if(_stopping) {
+					worker.finished = true;
+					break;
+				}
+				worker.commands_available.wait(lock);
+			}
+			continue;
+		}
+		// Returns early if a command interrupted us.
+		if(worker.session._reap(true)) {
+			while(worker.session._reap(false)) {
+				// Collect everything else that is already pending.
+			}
+		}
+	}
+	if(--_running_workers == 0) {
+		std::lock_guard<std::mutex> lock(_events_mutex);
+		_events_available.notify_all();
+	}
+}
+
+void tracer_pool::_run_commands(struct worker& worker) {
+	std::deque<std::function<void()>> commands;
+	{
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		commands.swap(worker.commands);
+		worker.n_taken = worker.n_submitted;
+	}
+	worker.commands_taken.notify_all();
+	for(auto& command : commands) {
+		command();
+	}
+}
+
+void tracer_pool::_handle(struct worker& worker, const struct tracer_event& event) {
+	tracer& target = *event.tracer;
+	if(_publish_events) {
+		// Decode now, so that the consumer never needs the stopped tracee.
+		struct tracer_pool_event published = {};
+		published.process_id = target.process_id();
+		published.thread_group_id = target.thread_group_id();
+		published.stop_reason = event.stop_reason;
+		published.status = target.status();
+		published.syscall_number = -1;
+		published.worker = worker.index;
+		if(event.stop_reason == SYSCALL_ENTRY || event.stop_reason == SECCOMP || event.stop_reason == EMULATED_SYSCALL) {
+			published.syscall_number = target.get_syscall_number();
+			const int n_arguments = (tracer::n_syscall_arguments < 6 ? tracer::n_syscall_arguments : 6);
+			for(int i = 0; i < n_arguments; i++) {
+				published.syscall_arguments[i] = target.get_syscall_argument(i);
+			}
+		} else if(event.stop_reason == SYSCALL_EXIT) {
+			published.syscall_number = target.get_syscall_number();
+			published.syscall_return_value = target.get_syscall_return_value();
+		}
+		const bool pushed = worker.events.push(published, [this, &worker]() {
+			/* Full under SPSC_BLOCK; the tracee stays stopped until the
+			   consumer catches up. Keep taking commands meanwhile, since
+			   the consumer may be blocked submitting one. */
+			_run_commands(worker);
+			if(_consumer_waiting) {
+				std::lock_guard<std::mutex> lock(_events_mutex);
+				_events_available.notify_one();
+			}
+			std::this_thread::yield();
+		});
+		if(pushed && _consumer_waiting) {
+			std::lock_guard<std::mutex> lock(_events_mutex);
+			_events_available.notify_one();
+		}
+	}
+	if(event.stop_reason == EXITED) {
+		std::lock_guard<std::mutex> lock(_owners_mutex);
+		auto owner = _owners.find(target.process_id());
+		if(owner != _owners.end() && owner->second == worker.index) {
+			_owners.erase(owner);
+		}
+	}
+	_handler(target, event.stop_reason);
+}
+
+void tracer_pool::_submit(struct worker& worker, std::function<void()> command) {
+	if(pthread_equal(pthread_self(), worker.native_thread)) {
+		// Called from the handler of this very worker.
+		command();
+		return;
+	}
+	std::unique_lock<std::mutex> lock(worker.mutex);
+	if(worker.finished) {
+		throw tracer_exception("Cannot submit to a tracer pool that has shut down.");
+	}
+	worker.commands.push_back(std::move(command));
+	const uint64_t ticket = ++worker.n_submitted;
+	worker.commands_available.notify_one();
+	/* The worker may be blocked in waitpid. A signal interrupts it, but is
+	   lost if it arrives just before the worker enters waitpid, so repeat
+	   it until the worker has taken the command. */
+	while(worker.n_taken < ticket) {
+		pthread_kill(worker.native_thread, wake_signal());
+		worker.commands_taken.wait_for(lock, std::chrono::milliseconds(1));
+	}
+}
+
+struct tracer_pool::worker& tracer_pool::_least_loaded() {
+	struct worker *least_loaded = _workers.front().get();
+	for(auto& worker : _workers) {
+		if(worker->tracees < least_loaded->tracees) {
+			least_loaded = worker.get();
+		}
+	}
+	// Count the new tracee right away, so that concurrent requests spread.
+	least_loaded->tracees++;
+	return *least_loaded;
+}
+
+struct tracer_pool::worker *tracer_pool::_owner(pid_t pid) {
+	std::lock_guard<std::mutex> lock(_owners_mutex);
+	auto owner = _owners.find(pid);
+	return (owner == _owners.end() ? NULL : _workers[owner->second].get());
+}
+
+std::future<pid_t> tracer_pool::spawn(std::function<void()> child_main) {
+	auto promise = std::make_shared<std::promise<pid_t>>();
+	std::future<pid_t> result = promise->get_future();
+	struct worker& worker = _least_loaded();
+	_submit(worker, [&worker, promise, child_main]() {
+		const pid_t parent = getpid();
+		try {
+			const pid_t child = worker.session.fork();
+			if(child == 0) {
+				child_main();
+				_exit(127);
+			}
+			promise->set_value(child);
+		} catch(...) {
+			if(getpid() != parent) {
+				exit_spawned_child();
+			}
+			promise->set_exception(std::current_exception());
+		}
+	});
+	return result;
+}
+
+std::future<void> tracer_pool::attach(pid_t pid) {
+	auto promise = std::make_shared<std::promise<void>>();
+	std::future<void> result = promise->get_future();
+	struct worker& worker = _least_loaded();
+	_submit(worker, [&worker, promise, pid]() {
+		try {
+			worker.session.attach(pid);
+			promise->set_value();
+		} catch(...) {
+			promise->set_exception(std::current_exception());
+		}
+	});
+	return result;
+}
+
+std::future<void> tracer_pool::execute(pid_t pid, std::function<void(tracer&)> command) {
+	auto promise = std::make_shared<std::promise<void>>();
+	std::future<void> result = promise->get_future();
+	struct worker *worker = _owner(pid);
+	if(worker == NULL) {
+		promise->set_exception(std::make_exception_ptr(tracer_exception("No tracee " + std::to_string(pid) + " in this pool.")));
+		return result;
+	}
+	_submit(*worker, [worker, promise, pid, command]() {
+		try {
+			tracer *target = worker->session.find(pid);
+			if(target == NULL) {
+				throw tracer_exception("Tracee " + std::to_string(pid) + " has exited or been detached.");
+			}
+			command(*target);
+			promise->set_value();
+		} catch(...) {
+			promise->set_exception(std::current_exception());
+		}
+	});
+	return result;
+}
+
+bool tracer_pool::try_next_event(struct tracer_pool_event& event) {
+	for(size_t i = 0; i < _workers.size(); i++) {
+		struct worker& worker = *_workers[_next_ring];
+		_next_ring = (_next_ring + 1) % _workers.size();
+		if(worker.events.try_pop(event, event.lost_before)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool tracer_pool::next_event(struct tracer_pool_event& event) {
+	while(!try_next_event(event)) {
+		if(_running_workers == 0) {
+			// Workers may have published right before finishing.
+			return try_next_event(event);
+		}
+		std::unique_lock<std::mutex> lock(_events_mutex);
+		_consumer_waiting = true;
+		if(try_next_event(event)) {
+			_consumer_waiting = false;
+			return true;
+		}
+		// Bounded, in case a worker published just before we started waiting.
+		_events_available.wait_for(lock, std::chrono::milliseconds(1));
+		_consumer_waiting = false;
+	}
+	return true;
+}
+
+void tracer_pool::shutdown() {
+	_stopping = true;
+	for(auto& worker : _workers) {
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		worker->commands_available.notify_one();
+	}
+	for(auto& worker : _workers) {
+		if(worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
+}
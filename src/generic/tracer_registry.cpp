@@ -0,0 +1,78 @@
+#include <algorithm>    // std::find
+#include "tracer_registry.hpp"
+
+tracer_handle tracer_registry::_add() {
+	uint32_t index = 0;
+	if(!_free_slots.empty()) {
+		index = _free_slots.back();
+		_free_slots.pop_back();
+	} else {
+		index = _slots.size();
+		_slots.emplace_back();
+	}
+	struct slot& slot = _slots[index];
+	slot.used = true;
+	const tracer_handle handle = { index, slot.generation };
+	slot.tracer._registry = this;
+	slot.tracer._handle = handle;
+	return handle;
+}
+
+void tracer_registry::_index(tracer& indexed) {
+	const uint32_t index = indexed._handle.index;
+	auto found = _slots_by_pid.find(indexed.tracee.process_id);
+	if(found != _slots_by_pid.end() && found->second == index) {
+		return;
+	}
+	_slots_by_pid[indexed.tracee.process_id] = index;
+	_slots_by_thread_group[indexed.tracee.thread_group_id].push_back(index);
+}
+
+void tracer_registry::_unindex(tracer& unindexed) {
+	const uint32_t index = unindexed._handle.index;
+	auto found = _slots_by_pid.find(unindexed.tracee.process_id);
+	if(found == _slots_by_pid.end() || found->second != index) {
+		return;
+	}
+	_slots_by_pid.erase(found);
+	auto group = _slots_by_thread_group.find(unindexed.tracee.thread_group_id);
+	if(group != _slots_by_thread_group.end()) {
+		std::vector<uint32_t>& threads = group->second;
+		auto thread = std::find(threads.begin(), threads.end(), index);
+		if(thread != threads.end()) {
+			threads.erase(thread);
+		}
+		if(threads.empty()) {
+			_slots_by_thread_group.erase(group);
+		}
+	}
+}
+
+tracer *tracer_registry::get(tracer_handle handle) {
+	if(handle.index >= _slots.size()) {
+		return NULL;
+	}
+	struct slot& slot = _slots[handle.index];
+	if(!slot.used || slot.generation != handle.generation) {
+		return NULL;
+	}
+	return &slot.tracer;
+}
+
+tracer *tracer_registry::find(pid_t pid) {
+	auto found = _slots_by_pid.find(pid);
+	return (found == _slots_by_pid.end() ? NULL : &_slots[found->second].tracer);
+}
+
+void tracer_registry::release(tracer_handle handle) {
+	tracer *released = get(handle);
+	if(released == NULL) {
+		return;
+	}
+	_unindex(*released);
+	struct slot& slot = _slots[handle.index];
+	slot.tracer = tracer();  // Drops cached memory, descriptors and mappings now
+	slot.generation++;
+	slot.used = false;
+	_free_slots.push_back(handle.index);
+}
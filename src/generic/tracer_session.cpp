@@ -0,0 +1,294 @@
+#include <sys/wait.h>   // __WALL, WNOHANG
+#include <sys/signalfd.h> // signalfd, struct signalfd_siginfo
+#include <signal.h>     // sigset_t, pthread_sigmask, SIGCHLD
+#include <unistd.h>     // read, close
+#include <dirent.h>     // opendir, readdir, closedir
+#include <cerrno>       // errno
+#include <cstdlib>      // strtol
+#include <cstring>      // strerror
+#include <fstream>      // std::ifstream
+#include "tracer_session.hpp"
+#include "tracer_counters.hpp"
+
+/**
+ * @brief Numerically named entries of `path`, e.g. the thread ids in
+ * /proc/<pid>/task; empty if the directory cannot be read.
+ */
+static std::vector<pid_t> numeric_entries(const std::string& path) {
+	std::vector<pid_t> entries;
+	DIR *directory = opendir(path.c_str());
+	if(directory == NULL) {
+		return entries;
+	}
+	while(struct dirent *entry = readdir(directory)) {
+		char *end = NULL;
+		const long number = strtol(entry->d_name, &end, 10);
+		if(end != entry->d_name && *end == '\0') {
+			entries.push_back(number);
+		}
+	}
+	closedir(directory);
+	return entries;
+}
+
+tracer_session::~tracer_session() {
+	if(_event_fd != -1) {
+		close(_event_fd);
+	}
+}
+
+tracer& tracer_session::_add_root() {
+	tracer& new_tracer = *_registry.get(_registry._add());
+	new_tracer._session = this;
+	new_tracer._settings.trace_children = true;
+	new_tracer._settings.trace_threads = true;
+	return new_tracer;
+}
+
+void tracer_session::_track(tracer& new_tracer) {
+	_registry._index(new_tracer);
+	if(_on_adopt) {
+		_on_adopt(new_tracer);
+	}
+}
+
+void tracer_session::_adopt(tracer& new_tracer) {
+	_track(new_tracer);
+	_events.push_back({ &new_tracer, new_tracer.tracee.stop_reason });
+}
+
+void tracer_session::_forget(tracer& forgotten) {
+	_unclaimed_statuses.erase(forgotten.tracee.process_id);
+	_finished.push_back(forgotten._handle);
+}
+
+void tracer_session::_vanish(tracer& vanished) {
+	// Reported like any other exit; released once the event is handed out.
+	_unclaimed_statuses.erase(vanished.tracee.process_id);
+	_events.push_back({ &vanished, EXITED });
+}
+
+bool tracer_session::_take_unclaimed_status(pid_t pid, int& status) {
+	auto unclaimed = _unclaimed_statuses.find(pid);
+	if(unclaimed == _unclaimed_statuses.end()) {
+		return false;
+	}
+	std::vector<int>& statuses = unclaimed->second;
+	status = statuses.front();
+	statuses.erase(statuses.begin());
+	if(statuses.empty()) {
+		_unclaimed_statuses.erase(unclaimed);
+	}
+	return true;
+}
+
+void tracer_session::_dispatch(pid_t pid, int status) {
+	tracer *target = _registry.find(pid);
+	if(target == NULL) {
+		_unclaimed_statuses[pid].push_back(status);
+		return;
+	}
+	// May adopt a forked child, which queues the child's event first.
+	const enum stop_reason stop_reason = target->_handle_wait_status(status);
+	if(stop_reason == NOT_STOPPED) {
+		// Handled internally, and the tracee resumed (e.g. an exec).
+		return;
+	}
+	_events.push_back({ target, stop_reason });
+}
+
+bool tracer_session::_reap(bool block) {
+	const int options = __WALL | (_this_thread_only ? __WNOTHREAD : 0) | (block ? 0 : WNOHANG);
+	int status = 0;
+	pid_t pid = -1;
+	struct rusage usage;
+	do {  // Retry `waitpid` if interrupted by signal
+		pid = tracer_wait(-1, &status, options, &usage);
+	} while(pid == -1 && errno == EINTR && !_this_thread_only);
+	if(pid == -1) {
+		if(errno == ECHILD || errno == EINTR) {
+			return false;
+		}
+		throw tracer_exception("waitpid returned unexpected error " + std::string(strerror(errno)));
+	}
+	if(pid == 0) {  // WNOHANG, and nothing pending
+		return false;
+	}
+#ifdef TRACER_COUNTERS
+	// Before dispatching, which may forget the tracer of an exited thread.
+	const tracer *waited = _registry.find(pid);
+	const pid_t process = (waited != NULL ? waited->thread_group_id() : pid);
+	TRACER_COUNT_USAGE(pid, process, usage, status);
+#endif
+	_dispatch(pid, status);
+	return true;
+}
+
+pid_t tracer_session::fork() {
+	tracer& new_tracer = _add_root();
+	pid_t child = -1;
+	try {
+		child = new_tracer.fork();
+	} catch(...) {
+		_registry.release(new_tracer._handle);
+		throw;
+	}
+	if(child != 0) {
+		_adopt(new_tracer);
+	}
+	return child;
+}
+
+pid_t tracer_session::fork(const std::vector<long>& traced_syscalls) {
+	tracer& new_tracer = _add_root();
+	pid_t child = -1;
+	try {
+		child = new_tracer.fork(traced_syscalls);
+	} catch(...) {
+		_registry.release(new_tracer._handle);
+		throw;
+	}
+	if(child != 0) {
+		_adopt(new_tracer);
+	}
+	return child;
+}
+
+tracer& tracer_session::attach(pid_t pid) {
+	tracer& new_tracer = _add_root();
+	try {
+		new_tracer.attach(pid);
+	} catch(...) {
+		_registry.release(new_tracer._handle);
+		throw;
+	}
+	_adopt(new_tracer);
+	return new_tracer;
+}
+
+tracer& tracer_session::seize(pid_t pid) {
+	tracer& new_tracer = _add_root();
+	try {
+		new_tracer.seize(pid);
+	} catch(...) {
+		_registry.release(new_tracer._handle);
+		throw;
+	}
+	_adopt(new_tracer);
+	return new_tracer;
+}
+
+size_t tracer_session::seize_process(pid_t pid, bool descendants) {
+	size_t n_seized = 0;
+	std::vector<pid_t> processes = { pid };
+	if(numeric_entries("/proc/" + std::to_string(pid) + "/task").empty()) {
+		throw tracer_exception("Unable to seize " + std::to_string(pid) + ": no such process.");
+	}
+	while(!processes.empty()) {
+		const std::string task = "/proc/" + std::to_string(processes.back()) + "/task";
+		processes.pop_back();
+		std::vector<pid_t> threads;
+		bool found_new = true;
+		while(found_new) {
+			found_new = false;
+			threads = numeric_entries(task);
+			for(pid_t thread : threads) {
+				if(_registry.find(thread) != NULL) {
+					continue;
+				}
+				tracer& new_tracer = _add_root();
+				bool seized = false;
+				try {
+					seized = new_tracer._seize(thread);
+				} catch(...) {
+					_registry.release(new_tracer._handle);
+					throw;
+				}
+				if(!seized) {
+					_registry.release(new_tracer._handle);
+					continue;
+				}
+				// Its INTERRUPTED stop arrives through `next_event`.
+				_track(new_tracer);
+				n_seized++;
+				found_new = true;
+			}
+		}
+		if(!descendants) {
+			continue;
+		}
+		for(pid_t thread : threads) {
+			std::ifstream children(task + "/" + std::to_string(thread) + "/children");
+			pid_t child = -1;
+			while(children >> child) {
+				processes.push_back(child);
+			}
+		}
+	}
+	return n_seized;
+}
+
+bool tracer_session::_pop_event(struct tracer_event& event) {
+	for(tracer_handle handle : _finished) {
+		_registry.release(handle);
+	}
+	_finished.clear();
+	if(_events.empty()) {
+		return false;
+	}
+	event = _events.front();
+	_events.pop_front();
+	if(event.stop_reason == EXITED) {
+		_finished.push_back(event.tracer->_handle);
+	}
+	return true;
+}
+
+bool tracer_session::next_event(struct tracer_event& event) {
+	while(_events.empty()) {
+		if(_registry.size() == 0) {
+			return false;
+		}
+		if(!_reap(true)) {
+			throw tracer_exception("No children left to wait for, but " + std::to_string(_registry.size()) +
+			                       " tracees of the session have not been observed to exit.");
+		}
+		while(_reap(false)) {
+			// Collect everything else that is already pending.
+		}
+	}
+	return _pop_event(event);
+}
+
+bool tracer_session::try_next_event(struct tracer_event& event) {
+	if(_events.empty()) {
+		if(_event_fd != -1) {
+			/* Drain before reaping: a stop after this point signals the
+			   descriptor again, so none can be missed. */
+			struct signalfd_siginfo info;
+			while(read(_event_fd, &info, sizeof(info)) == sizeof(info)) {
+			}
+		}
+		while(_reap(false)) {
+			// Collect everything that is already pending.
+		}
+	}
+	return _pop_event(event);
+}
+
+int tracer_session::event_fd() {
+	if(_event_fd != -1) {
+		return _event_fd;
+	}
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	if(pthread_sigmask(SIG_BLOCK, &mask, NULL) != 0) {
+		throw tracer_exception("Unable to block SIGCHLD for the session event descriptor.");
+	}
+	_event_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if(_event_fd == -1) {
+		throw tracer_exception("Unable to create the session event descriptor: " + std::string(strerror(errno)));
+	}
+	return _event_fd;
+}
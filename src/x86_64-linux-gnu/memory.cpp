@@ -0,0 +1,44 @@
+#include <emmintrin.h>  // SSE2 intrinsics
+#include <immintrin.h>  // AVX2 intrinsics
+#include "tracer.hpp"
+
+static size_t find_nul_sse2(const char *buffer, size_t length) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for(; i + 16 <= length; i += 16) {
+		const __m128i chunk = _mm_loadu_si128((const __m128i *)(buffer + i));
+		const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero));
+		if(mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+	for(; i < length; i++) {
+		if(buffer[i] == 0) {
+			return i;
+		}
+	}
+	return length;
+}
+
+__attribute__((target("avx2")))
+static size_t find_nul_avx2(const char *buffer, size_t length) {
+	const __m256i zero = _mm256_setzero_si256();
+	size_t i = 0;
+	for(; i + 32 <= length; i += 32) {
+		const __m256i chunk = _mm256_loadu_si256((const __m256i *)(buffer + i));
+		const unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, zero));
+		if(mask != 0) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+	return i + find_nul_sse2(buffer + i, length - i);
+}
+
+size_t tracer::_find_nul(const char *buffer, size_t length) {
+	// SSE2 is part of the x86_64 baseline; AVX2 has to be checked for.
+	static const bool have_avx2 = __builtin_cpu_supports("avx2");
+	if(have_avx2) {
+		return find_nul_avx2(buffer, length);
+	}
+	return find_nul_sse2(buffer, length);
+}
@@ -1,16 +1,21 @@
 #include <sys/uio.h>    // struct iovec
 #include <linux/elf.h>  // NT_PRSTATUS, NT_ARM_SYSTEM_CALL
+#include <linux/audit.h> // AUDIT_ARCH_X86_64
 #include <cstring>      // strerror
 #include <errno.h>      // errno
 #include "tracer.hpp"
+#include "tracer_counters.hpp"
 
 const int tracer::n_syscall_arguments = 6;
+const int tracer::syscall_instruction_length = 2;  // syscall (0f 05)
+const uint32_t tracer::_audit_architecture = AUDIT_ARCH_X86_64;
 
 long tracer::_read_registers_internal(pid_t pid, struct user_regs_struct& destination) {
 	struct iovec iov {
 		(void *)&destination,
 		sizeof(destination)
 	};
+	TRACER_COUNT_PTRACE(PTRACE_GETREGSET);
 	return ptrace(PTRACE_GETREGSET, pid, NT_PRSTATUS, &iov);
 }
 
@@ -19,10 +24,11 @@ long tracer::_write_registers_internal(pid_t pid, const struct user_regs_struct&
 		(void *)&source,
 		sizeof(source)
 	};
+	TRACER_COUNT_PTRACE(PTRACE_SETREGSET);
 	return ptrace(PTRACE_SETREGSET, pid, NT_PRSTATUS, &iov);
 }
 
-long tracer::get_syscall_number() {
+long tracer::_read_syscall_number() {
 	tracer_ensure_invariants();
 	const struct user_regs_struct& registers = read_registers();
 	return registers.orig_rax;
@@ -39,7 +45,7 @@ void tracer::set_syscall_number(long number) {
 	write_registers(new_registers);
 }
 
-long tracer::get_syscall_argument(size_t i) {
+long tracer::_read_syscall_argument(size_t i) {
 	// See e.g. glibc sysdeps/unix/sysv/linux/x86_64/syscall.S
 	// for the registers to arguments correspondence
 	tracer_ensure_invariants();
@@ -91,7 +97,7 @@ void tracer::set_syscall_argument(size_t i, long value) {
 	write_registers(new_registers);
 }
 
-long tracer::get_syscall_return_value() {
+long tracer::_read_syscall_return_value() {
 	tracer_ensure_invariants();
 	const struct user_regs_struct& registers = read_registers();
 	return registers.rax;
@@ -103,3 +109,20 @@ void tracer::set_syscall_return_value(long value) {
 	new_registers.rax = value;
 	write_registers(new_registers);
 }
+
+long tracer::_read_instruction_pointer() {
+	tracer_ensure_invariants();
+	return read_registers().rip;
+}
+
+long tracer::_read_stack_pointer() {
+	tracer_ensure_invariants();
+	return read_registers().rsp;
+}
+
+void tracer::_rewind_syscall(long number) {
+	struct user_regs_struct new_registers = read_registers();
+	new_registers.rip -= syscall_instruction_length;
+	new_registers.rax = number;  // The syscall instruction takes the number from rax, not orig_rax
+	write_registers(new_registers);
+}
@@ -0,0 +1,196 @@
+#include <unistd.h>       // getpid, _exit
+#include <sys/wait.h>     // WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // syscall, SYS_getppid
+#include <atomic>
+#include <cstdio>         // printf
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc_ring.hpp"
+#include "tracer_pool.hpp"
+
+/* Checks `spsc_ring` on its own, under each overflow policy and across
+   two threads, then the events a `tracer_pool` publishes through its
+   rings: with a consumer keeping up, every stop must arrive in order,
+   with the system call decoded; with a ring too small and nobody
+   consuming under SPSC_COUNT, the tracee must run on and the events that
+   do not fit must be counted as dropped. */
+
+static const int n_getppid = 200;
+static const long arguments[6] = { 11, 12, 13, 14, 15, 16 };
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static void ring_policies() {
+	spsc_ring<int> ring(5);
+	check(ring.capacity() == 8 && ring.policy() == SPSC_BLOCK, "capacity is rounded up to a power of two");
+	for(int i = 0; i < 8; i++) {
+		check(ring.try_push(i), "try_push below capacity");
+	}
+	check(!ring.try_push(8) && ring.size() == 8, "try_push fails when full");
+	int popped = -1;
+	int calls = 0;
+	check(ring.push(8, [&]() { calls++; check(ring.try_pop(popped), "try_pop"); }), "blocking push succeeds");
+	check(calls == 1 && popped == 0, "blocking push calls on_full until there is room");
+	for(int i = 1; i <= 8; i++) {
+		check(ring.try_pop(popped) && popped == i, "values come out in order");
+	}
+	check(!ring.try_pop(popped) && ring.size() == 0, "try_pop fails when empty");
+	struct spsc_ring_statistics statistics = ring.statistics();
+	check(statistics.pushed == 9 && statistics.popped == 9 && statistics.dropped == 0 && statistics.blocked == 1
+	      && statistics.high_watermark == 8, "statistics of a blocking ring");
+
+	spsc_ring<int> dropping(4, SPSC_DROP);
+	for(int i = 0; i < 6; i++) {
+		check(dropping.push(i) == (i < 4), "dropping push fails when full");
+	}
+	uint64_t lost_before = 0;
+	check(dropping.try_pop(popped, lost_before) && popped == 0 && lost_before == 0, "SPSC_DROP does not report losses");
+	check(dropping.push(6), "dropping push succeeds once there is room");
+	statistics = dropping.statistics();
+	check(statistics.pushed == 5 && statistics.dropped == 2 && statistics.blocked == 0, "statistics of a dropping ring");
+
+	spsc_ring<int> counting(4, SPSC_COUNT);
+	for(int i = 0; i < 7; i++) {
+		check(counting.push(i) == (i < 4), "counting push fails when full");
+	}
+	check(counting.try_pop(popped, lost_before) && popped == 0 && lost_before == 0, "pop before the losses");
+	check(counting.push(7) && counting.push(8, []() {}) == false, "counting push refills the ring");
+	for(int i = 1; i <= 3; i++) {
+		check(counting.try_pop(popped, lost_before) && popped == i && lost_before == 0, "values pushed before the losses");
+	}
+	check(counting.try_pop(popped, lost_before) && popped == 7 && lost_before == 3, "losses are reported with the next value");
+	check(counting.push(9) && counting.try_pop(popped, lost_before) && popped == 9 && lost_before == 1,
+	      "later losses are reported with the next value");
+	check(counting.statistics().dropped == 4, "SPSC_COUNT counts discarded values");
+}
+
+static void ring_threads() {
+	const uint64_t n_values = 100000;
+	spsc_ring<uint64_t> ring(64);
+	std::thread producer([&ring, n_values]() {
+		for(uint64_t i = 0; i < n_values; i++) {
+			ring.push(i);
+		}
+	});
+	uint64_t expected = 0;
+	bool ordered = true;
+	uint64_t value = 0;
+	while(expected < n_values) {
+		if(!ring.try_pop(value)) {
+			std::this_thread::yield();
+			continue;
+		}
+		ordered = ordered && value == expected;
+		expected++;
+	}
+	producer.join();
+	check(ordered, "values cross threads in order");
+	const struct spsc_ring_statistics statistics = ring.statistics();
+	check(statistics.pushed == n_values && statistics.popped == n_values && statistics.high_watermark <= 64,
+	      "statistics across threads");
+}
+
+static void workload() {
+	for(int i = 0; i < n_getppid; i++) {
+		syscall(SYS_getppid, arguments[0], arguments[1], arguments[2], arguments[3], arguments[4], arguments[5]);
+	}
+	_exit(0);
+}
+
+static void pool_events() {
+	std::atomic<uint64_t> handled(0);
+	tracer_pool pool(2, [&handled](tracer& tracee, enum stop_reason reason) {
+		handled++;
+		if(reason != EXITED) {
+			tracee.resume(SYSCALL_ENTRY);
+		}
+	}, 16, SPSC_BLOCK);
+	std::vector<pid_t> tracees = { pool.spawn(workload).get(), pool.spawn(workload).get() };
+	std::vector<struct tracer_pool_event> events;
+	std::thread consumer([&pool, &events]() {
+		struct tracer_pool_event event;
+		while(pool.next_event(event)) {
+			events.push_back(event);
+		}
+	});
+	pool.shutdown();
+	consumer.join();
+
+	check(events.size() == handled, "every stop is published");
+	uint64_t pushed = 0;
+	for(size_t worker = 0; worker < 2; worker++) {
+		const struct spsc_ring_statistics statistics = pool.event_statistics(worker);
+		check(statistics.dropped == 0 && statistics.popped == statistics.pushed && statistics.high_watermark <= 16,
+		      "statistics of a blocking event ring");
+		pushed += statistics.pushed;
+	}
+	check(pushed == events.size(), "statistics count every event");
+	for(pid_t pid : tracees) {
+		int entries = 0;
+		int exits = 0;
+		bool exited = false;
+		for(const struct tracer_pool_event& event : events) {
+			if(event.process_id != pid) {
+				continue;
+			}
+			check(!exited, "no event after the exit");
+			check(event.lost_before == 0, "nothing is lost under SPSC_BLOCK");
+			if(event.stop_reason == SYSCALL_ENTRY && event.syscall_number == SYS_getppid) {
+				check(exits == entries, "entry and exit alternate");
+				for(int i = 0; i < 6; i++) {
+					check(event.syscall_arguments[i] == arguments[i], "arguments are decoded");
+				}
+				entries++;
+			} else if(event.stop_reason == SYSCALL_EXIT && event.syscall_number == SYS_getppid) {
+				check(event.syscall_return_value == getpid(), "return value is decoded");
+				exits++;
+			} else if(event.stop_reason == EXITED) {
+				check(WIFEXITED(event.status) && WEXITSTATUS(event.status) == 0, "tracee exits normally");
+				exited = true;
+			}
+		}
+		check(entries == n_getppid && exits == n_getppid && exited, "every stop of the tracee is published");
+	}
+}
+
+static void pool_overflow() {
+	std::atomic<uint64_t> handled(0);
+	tracer_pool pool(1, [&handled](tracer& tracee, enum stop_reason reason) {
+		handled++;
+		if(reason != EXITED) {
+			tracee.resume(SYSCALL_ENTRY);
+		}
+	}, 4, SPSC_COUNT);
+	pool.spawn(workload).get();
+	// Nobody consumes until the tracee is done; its stops must not wait.
+	pool.shutdown();
+	uint64_t popped = 0;
+	uint64_t lost = 0;
+	struct tracer_pool_event event;
+	while(pool.next_event(event)) {
+		popped++;
+		lost += event.lost_before;
+	}
+	const struct spsc_ring_statistics statistics = pool.event_statistics(0);
+	check(popped == 4 && statistics.pushed == 4, "a full ring keeps the first events");
+	check(statistics.pushed + statistics.dropped == handled, "every stop is either published or dropped");
+	check(lost == 0 && statistics.dropped > 0, "losses after the last event are only in the statistics");
+}
+
+int main() {
+	try {
+		ring_policies();
+		ring_threads();
+		pool_events();
+		pool_overflow();
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,124 @@
+#include <unistd.h>       // sysconf, execl, _exit
+#include <sys/mman.h>     // mmap, mprotect, munmap
+#include <sys/wait.h>     // WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // syscall, SYS_getppid, SYS_execve
+#include <cstdio>         // printf
+#include <cstring>        // memset, memcmp, strcmp
+#include <string>
+#include <vector>
+#include "tracer.hpp"
+
+/* Reads and writes the same tracee pages with each memory backend: a
+   read-only page, a page without any access, which process_vm_readv and
+   process_vm_writev cannot reach, and an unmapped page after them. Every
+   backend must reach the first two, one way or another, and stop at the
+   third. The /proc/<pid>/mem descriptor must also follow the tracee
+   across an execve, whose first stop in the new program is its exit. */
+
+static const char *const exec_marker = "after exec";
+
+static size_t page_size() {
+	return sysconf(_SC_PAGESIZE);
+}
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static void workload(const char *self) {
+	const size_t page = page_size();
+	char *pages = (char *)mmap(NULL, 3 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(pages == MAP_FAILED) {
+		_exit(1);
+	}
+	memset(pages, 'a', page);
+	memset(pages + page, 'b', page);
+	if(munmap(pages + 2 * page, page) != 0 || mprotect(pages, page, PROT_READ) != 0
+	   || mprotect(pages + page, page, PROT_NONE) != 0) {
+		_exit(2);
+	}
+	syscall(SYS_getppid, pages);
+	// The tracer wrote "xyz" into the read-only page.
+	if(memcmp(pages + 1, "xyz", 3) != 0 || pages[0] != 'a' || pages[4] != 'a') {
+		_exit(3);
+	}
+	execl(self, self, "exec", (char *)NULL);
+	_exit(4);
+}
+
+static void after_exec() {
+	syscall(SYS_getppid, exec_marker);
+	_exit(0);
+}
+
+static void stop_at_getppid(tracer& tracee) {
+	do {
+		check(tracee.resume_and_wait(SYSCALL_ENTRY), "tracee reaches getppid");
+	} while(tracee.get_syscall_number() != SYS_getppid);
+}
+
+static void run(enum memory_backend backend, const char *self) {
+	const size_t page = page_size();
+	tracer tracee;
+	tracee.set_memory_backend(backend);
+	if(tracee.fork() == 0) {
+		workload(self);
+	}
+	stop_at_getppid(tracee);
+	char *pages = (char *)tracee.get_syscall_argument(0);
+
+	std::vector<char> buffer(3 * page);
+	check(tracee.read_memory(pages, buffer.data(), buffer.size()) == 2 * page, "read stops at the unmapped page");
+	check(buffer[0] == 'a' && buffer[page - 1] == 'a', "read-only page is read");
+	check(buffer[page] == 'b' && buffer[2 * page - 1] == 'b', "page without access is read");
+	char small[3] = {};
+	check(tracee.read_memory(pages + page - 1, small, sizeof(small)) == sizeof(small)
+	      && small[0] == 'a' && small[1] == 'b' && small[2] == 'b', "unaligned read across pages");
+
+	check(tracee.write_memory(pages + 1, "xyz", 3) == 3, "write to the read-only page");
+	const std::string across(16, 'c');
+	check(tracee.write_memory(pages + page - 8, across.data(), across.size()) == across.size(),
+	      "write across the read-only page and the page without access");
+	check(tracee.write_memory(pages + 2 * page - 4, across.data(), across.size()) == 4,
+	      "write stops at the unmapped page");
+	check(tracee.read_memory(pages + page - 8, buffer.data(), 16) == 16 && memcmp(buffer.data(), across.data(), 16) == 0,
+	      "writes read back");
+	// Undo the bytes the workload checks.
+	memset(buffer.data(), 'a', 8);
+	check(tracee.write_memory(pages + page - 8, buffer.data(), 8) == 8, "restore the read-only page");
+
+	check(tracee.resume_and_wait(SYSCALL_ENTRY), "tracee reaches execve");
+	while(tracee.get_syscall_number() != SYS_execve) {
+		check(tracee.resume_and_wait(SYSCALL_ENTRY), "tracee reaches execve");
+	}
+	tracee.resume(SYSCALL_EXIT);
+	check(tracee.wait() == SYSCALL_EXIT && tracee.get_syscall_number() == SYS_execve
+	      && tracee.get_syscall_return_value() == 0, "first stop after execve is its exit");
+	stop_at_getppid(tracee);
+	bool terminated = false;
+	check(tracee.read_string((void *)tracee.get_syscall_argument(0), 64, &terminated) == exec_marker && terminated,
+	      "memory of the new program is read");
+	check(tracee.resume_and_wait(EXITED) && WIFEXITED(tracee.status()) && WEXITSTATUS(tracee.status()) == 0,
+	      "tracee exits normally");
+}
+
+int main(int argc, char **argv) {
+	if(argc > 1 && strcmp(argv[1], "exec") == 0) {
+		after_exec();
+	}
+	try {
+		for(enum memory_backend backend : { MEMORY_PTRACE, MEMORY_PROCESS_VM, MEMORY_PROC_MEM }) {
+			try {
+				run(backend, "/proc/self/exe");
+			} catch(const tracer_exception& e) {
+				throw tracer_exception(std::string(e.what()) + " (backend " + std::to_string(backend) + ")");
+			}
+		}
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,101 @@
+#include <unistd.h>       // sysconf, pwrite, close, _exit
+#include <fcntl.h>        // open
+#include <sys/mman.h>     // mmap
+#include <sys/wait.h>     // WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // syscall, SYS_getppid
+#include <cstdio>         // printf
+#include <string>
+#include "tracer.hpp"
+
+/* Changes tracee words behind the tracer's back, through a /proc/<pid>/mem
+   descriptor of the test's own, and checks when `read_word` sees the
+   change: not while the page is cached, but after writes through the
+   tracer, after the page was evicted, after the tracee was resumed, and
+   always with the cache disabled. */
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static size_t page_size() {
+	return sysconf(_SC_PAGESIZE);
+}
+
+static void workload() {
+	long *pages = (long *)mmap(NULL, 3 * page_size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(pages == MAP_FAILED) {
+		_exit(1);
+	}
+	pages[0] = 1;
+	syscall(SYS_getppid, pages);
+	pages[0] += 10;
+	syscall(SYS_getppid, pages);
+	_exit(0);
+}
+
+static void stop_at_getppid(tracer& tracee) {
+	do {
+		check(tracee.resume_and_wait(SYSCALL_ENTRY), "tracee reaches getppid");
+	} while(tracee.get_syscall_number() != SYS_getppid);
+}
+
+static void poke_behind(int fd, long *address, long value) {
+	check(pwrite(fd, &value, sizeof(value), (off_t)address) == sizeof(value), "write through /proc/<pid>/mem");
+}
+
+static void run(size_t cache_pages) {
+	const size_t words_per_page = page_size() / sizeof(long);
+	tracer tracee;
+	tracee.set_memory_cache_pages(cache_pages);
+	if(tracee.fork() == 0) {
+		workload();
+	}
+	const int fd = open(("/proc/" + std::to_string(tracee.process_id()) + "/mem").c_str(), O_RDWR);
+	check(fd != -1, "open /proc/<pid>/mem");
+	stop_at_getppid(tracee);
+	long *pages = (long *)tracee.get_syscall_argument(0);
+	const bool cached = (cache_pages > 0);
+
+	check(tracee.read_word(pages) == 1, "first read");
+	poke_behind(fd, pages, 2);
+	check(tracee.read_word(pages) == (cached ? 1 : 2), "cached page is kept within a stop");
+	tracee.write_word(pages, 3);
+	check(tracee.read_word(pages) == 3, "write_word drops the cache");
+	long value = 4;
+	check(tracee.write_memory(pages, &value, sizeof(value)) == sizeof(value), "write_memory");
+	check(tracee.read_word(pages) == 4, "write_memory drops the cache");
+
+	if(cache_pages == 2) {
+		// Round-robin: the third page evicts the first.
+		check(tracee.read_word(pages + words_per_page) == 0 && tracee.read_word(pages + 2 * words_per_page) == 0,
+		      "read the other pages");
+		poke_behind(fd, pages, 5);
+		poke_behind(fd, pages + 2 * words_per_page, 5);
+		check(tracee.read_word(pages + 2 * words_per_page) == 0, "last page read is still cached");
+		check(tracee.read_word(pages) == 5, "evicted page is read again");
+	}
+
+	stop_at_getppid(tracee);
+	check(tracee.read_word(pages) == (cache_pages == 2 ? 15 : 14), "resume drops the cache");
+	check(tracee.resume_and_wait(EXITED) && WIFEXITED(tracee.status()) && WEXITSTATUS(tracee.status()) == 0,
+	      "tracee exits normally");
+	close(fd);
+}
+
+int main() {
+	try {
+		for(size_t cache_pages : { 0, 2, 8 }) {
+			try {
+				run(cache_pages);
+			} catch(const tracer_exception& e) {
+				throw tracer_exception(std::string(e.what()) + " (" + std::to_string(cache_pages) + " pages)");
+			}
+		}
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,133 @@
+#include <unistd.h>       // pipe, read, write, close, usleep, _exit
+#include <poll.h>         // poll
+#include <sys/wait.h>     // WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // SYS_read
+#include <chrono>
+#include <cstdio>         // printf
+#include <string>
+#include "tracer.hpp"
+#include "tracer_session.hpp"
+
+/* Traces a workload that blocks reading a pipe until the test writes to
+   it. While it is blocked, `try_wait` must report NOT_STOPPED and the
+   session's `event_fd` must not poll readable, with `try_next_event`
+   returning nothing; once written to, the exit of read must come through
+   both of them, as must the exit of the tracee. */
+
+static int fds[2];
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static void workload() {
+	close(fds[1]);
+	char c = 0;
+	_exit(read(fds[0], &c, 1) == 1 && c == 'x' ? 0 : 1);
+}
+
+static void release_workload() {
+	check(write(fds[1], "x", 1) == 1, "write");
+	close(fds[1]);
+}
+
+static void lone_tracer() {
+	check(pipe(fds) == 0, "pipe");
+	tracer tracee;
+	if(tracee.fork() == 0) {
+		workload();
+	}
+	close(fds[0]);
+	do {
+		check(tracee.resume_and_wait(SYSCALL_ENTRY), "tracee reaches read");
+	} while(tracee.get_syscall_number() != SYS_read);
+	tracee.resume(SYSCALL_EXIT);
+	for(int i = 0; i < 5; i++) {
+		check(tracee.try_wait() == NOT_STOPPED && tracee.stop_reason() == NOT_STOPPED,
+		      "try_wait reports NOT_STOPPED while the tracee is blocked");
+		usleep(10000);
+	}
+	release_workload();
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while(tracee.try_wait() == NOT_STOPPED) {
+		check(std::chrono::steady_clock::now() < deadline, "try_wait reports the stop");
+		usleep(1000);
+	}
+	check(tracee.stop_reason() == SYSCALL_EXIT && tracee.get_syscall_return_value() == 1, "stop is the exit of read");
+	tracee.resume(EXITED);
+	while(tracee.try_wait() == NOT_STOPPED) {
+		check(std::chrono::steady_clock::now() < deadline, "try_wait reports the exit");
+		usleep(1000);
+	}
+	check(tracee.stop_reason() == EXITED && WIFEXITED(tracee.status()) && WEXITSTATUS(tracee.status()) == 0,
+	      "tracee exits normally");
+}
+
+static bool readable(int fd, int timeout_ms) {
+	struct pollfd poll_fd = { fd, POLLIN, 0 };
+	return poll(&poll_fd, 1, timeout_ms) == 1 && (poll_fd.revents & POLLIN) != 0;
+}
+
+static void in_session() {
+	check(pipe(fds) == 0, "pipe");
+	tracer_session session;
+	const int event_fd = session.event_fd();
+	const pid_t pid = session.fork();
+	if(pid == 0) {
+		workload();
+	}
+	close(fds[0]);
+	bool blocked = false;
+	bool returned = false;
+	bool exited = false;
+	struct tracer_event event;
+	// Stops from before `event_fd` was first polled need not have made it readable.
+	bool drain = true;
+	while(!exited) {
+		if(!drain) {
+			check(readable(event_fd, 10000), "event_fd polls readable for a stop");
+		}
+		drain = false;
+		while(session.try_next_event(event)) {
+			check(event.tracer->process_id() == pid, "only the tracee stops");
+			if(event.stop_reason == EXITED) {
+				check(WIFEXITED(event.tracer->status()) && WEXITSTATUS(event.tracer->status()) == 0,
+				      "tracee exits normally");
+				exited = true;
+			} else if(event.stop_reason == SYSCALL_ENTRY && event.tracer->get_syscall_number() == SYS_read) {
+				event.tracer->resume(SYSCALL_EXIT);
+				blocked = true;
+			} else if(event.stop_reason == SYSCALL_EXIT && event.tracer->get_syscall_number() == SYS_read) {
+				check(!blocked && event.tracer->get_syscall_return_value() == 1, "read returns after the write");
+				returned = true;
+				event.tracer->resume(EXITED);
+			} else {
+				event.tracer->resume(SYSCALL_ENTRY);
+			}
+		}
+		if(blocked) {
+			check(!readable(event_fd, 50), "event_fd is not readable while the tracee is blocked");
+			check(!session.try_next_event(event), "try_next_event returns nothing while the tracee is blocked");
+			blocked = false;
+			release_workload();
+		}
+		if(!exited && session.find(pid) != NULL && session.find(pid)->stop_reason() != NOT_STOPPED) {
+			// Still stopped from `fork`, without an event.
+			session.find(pid)->resume(SYSCALL_ENTRY);
+		}
+	}
+	check(returned, "exit of read is reported");
+}
+
+int main() {
+	try {
+		lone_tracer();
+		in_session();
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
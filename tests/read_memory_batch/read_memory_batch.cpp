@@ -0,0 +1,119 @@
+#include <unistd.h>       // sysconf, _exit
+#include <sys/mman.h>     // mmap, mprotect, munmap
+#include <sys/wait.h>     // WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // syscall, SYS_getppid
+#include <climits>        // IOV_MAX
+#include <cstdio>         // printf
+#include <string>
+#include <vector>
+#include "tracer.hpp"
+
+/* Reads more regions than fit in one process_vm_readv with
+   `read_memory_batch`, under every backend. Among them are a region in a
+   page without access, which process_vm_readv cannot reach but ptrace
+   can, and regions in and running into an unmapped page, which nothing
+   can read. Each region must be flagged on its own, with the batch going
+   on after the failed ones. */
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static size_t page_size() {
+	return sysconf(_SC_PAGESIZE);
+}
+
+// Byte `i` of the tracee's pages.
+static char pattern(size_t i) {
+	return (char)(i * 7 + i / 251);
+}
+
+static void workload() {
+	const size_t page = page_size();
+	char *pages = (char *)mmap(NULL, 4 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(pages == MAP_FAILED) {
+		_exit(1);
+	}
+	for(size_t i = 0; i < 3 * page; i++) {
+		pages[i] = pattern(i);
+	}
+	if(mprotect(pages + 2 * page, page, PROT_NONE) != 0 || munmap(pages + 3 * page, page) != 0) {
+		_exit(2);
+	}
+	syscall(SYS_getppid, pages);
+	_exit(0);
+}
+
+static void run(enum memory_backend backend) {
+	const size_t page = page_size();
+	tracer tracee;
+	tracee.set_memory_backend(backend);
+	if(tracee.fork() == 0) {
+		workload();
+	}
+	do {
+		check(tracee.resume_and_wait(SYSCALL_ENTRY), "tracee reaches getppid");
+	} while(tracee.get_syscall_number() != SYS_getppid);
+	char *pages = (char *)tracee.get_syscall_argument(0);
+
+	// Small regions all over the two accessible pages, more than one batch's worth.
+	std::vector<size_t> starts;
+	std::vector<size_t> lengths;
+	for(size_t i = 0; starts.size() < IOV_MAX + 100; i++) {
+		starts.push_back((i * 37) % (2 * page - 16));
+		lengths.push_back(1 + i % 16);
+	}
+	const size_t no_access = starts.size();
+	starts.push_back(2 * page + 3);
+	lengths.push_back(10);
+	const size_t unmapped = starts.size();
+	starts.push_back(3 * page + 8);
+	lengths.push_back(8);
+	const size_t into_unmapped = starts.size();
+	starts.push_back(3 * page - 4);
+	lengths.push_back(8);
+	for(size_t i = 0; i < 20; i++) {
+		starts.push_back(page - 10 + i);
+		lengths.push_back(20);
+	}
+
+	std::vector<std::vector<char>> buffers(starts.size());
+	std::vector<struct memory_region> regions(starts.size());
+	for(size_t i = 0; i < regions.size(); i++) {
+		buffers[i].assign(lengths[i], 0);
+		regions[i] = { pages + starts[i], buffers[i].data(), lengths[i], false };
+	}
+	check(tracee.read_memory_batch(regions) == regions.size() - 2, "all but two regions are read");
+	check(regions[no_access].success, "region without access is read through the fallback");
+	for(size_t i = 0; i < regions.size(); i++) {
+		if(i == unmapped || i == into_unmapped) {
+			check(!regions[i].success, "region " + std::to_string(i) + " in unmapped memory fails");
+			continue;
+		}
+		check(regions[i].success, "region " + std::to_string(i) + " is read");
+		for(size_t j = 0; j < lengths[i]; j++) {
+			check(buffers[i][j] == pattern(starts[i] + j), "contents of region " + std::to_string(i));
+		}
+	}
+
+	check(tracee.resume_and_wait(EXITED) && WIFEXITED(tracee.status()) && WEXITSTATUS(tracee.status()) == 0,
+	      "tracee exits normally");
+}
+
+int main() {
+	try {
+		for(enum memory_backend backend : { MEMORY_PTRACE, MEMORY_PROCESS_VM, MEMORY_PROC_MEM }) {
+			try {
+				run(backend);
+			} catch(const tracer_exception& e) {
+				throw tracer_exception(std::string(e.what()) + " (backend " + std::to_string(backend) + ")");
+			}
+		}
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
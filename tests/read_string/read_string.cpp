@@ -0,0 +1,116 @@
+#include <unistd.h>       // sysconf, _exit
+#include <sys/mman.h>     // mmap, munmap
+#include <sys/wait.h>     // WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // syscall, SYS_getppid
+#include <cstdio>         // printf
+#include <string>
+#include <vector>
+#include "tracer.hpp"
+
+/* Writes strings into the last two pages before an unmapped one in the
+   tracee, and reads them back with `read_string` under every backend,
+   with and without the page cache: every length up to a few vector
+   widths at every alignment, bytes with the high bit set, strings
+   crossing a page boundary, strings cut by `max_length`, and strings
+   running into the unmapped page. */
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static size_t page_size() {
+	return sysconf(_SC_PAGESIZE);
+}
+
+static void workload() {
+	char *pages = (char *)mmap(NULL, 3 * page_size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(pages == MAP_FAILED || munmap(pages + 2 * page_size(), page_size()) != 0) {
+		_exit(1);
+	}
+	syscall(SYS_getppid, pages);
+	_exit(0);
+}
+
+// Writes `contents` at `address`, followed by a NUL unless told otherwise.
+static void put(tracer& tracee, char *address, const std::string& contents, bool nul=true) {
+	const std::string written = contents + (nul ? std::string(1, '\0') : std::string());
+	check(tracee.write_memory(address, written.data(), written.size()) == written.size(), "write string");
+}
+
+static void expect(tracer& tracee, char *address, size_t max_length, const std::string& expected, bool expected_terminated,
+                   const std::string& what) {
+	bool terminated = !expected_terminated;
+	const std::string read = tracee.read_string(address, max_length, &terminated);
+	check(read == expected && terminated == expected_terminated, what);
+}
+
+static void run(enum memory_backend backend, size_t cache_pages) {
+	const size_t page = page_size();
+	tracer tracee;
+	tracee.set_memory_backend(backend);
+	tracee.set_memory_cache_pages(cache_pages);
+	if(tracee.fork() == 0) {
+		workload();
+	}
+	do {
+		check(tracee.resume_and_wait(SYSCALL_ENTRY), "tracee reaches getppid");
+	} while(tracee.get_syscall_number() != SYS_getppid);
+	char *pages = (char *)tracee.get_syscall_argument(0);
+	char *end = pages + 2 * page;
+
+	std::string contents;
+	for(size_t length = 0; length <= 200; length++) {
+		contents.push_back((char)(0x80 + length % 0x7f));
+	}
+	std::vector<char> filler(page, 'x');
+	for(size_t alignment = 0; alignment < 16; alignment++) {
+		for(size_t length = 0; length <= 200; length += (length < 70 ? 1 : 13)) {
+			check(tracee.write_memory(pages, filler.data(), filler.size()) == filler.size(), "fill page");
+			put(tracee, pages + alignment, contents.substr(0, length));
+			expect(tracee, pages + alignment, 4096, contents.substr(0, length), true,
+			       "length " + std::to_string(length) + " at alignment " + std::to_string(alignment));
+		}
+	}
+
+	put(tracee, pages + page - 5, "across a page");
+	expect(tracee, pages + page - 5, 64, "across a page", true, "string across a page boundary");
+	expect(tracee, pages + page - 5, 6, "across", false, "string cut by max_length");
+	expect(tracee, pages + page - 5, 13, "across a page", false, "max_length right before the terminator");
+
+	put(tracee, end - 5, "last");
+	expect(tracee, end - 5, 64, "last", true, "string ending at the end of the mapping");
+	put(tracee, end - 5, "open!", false);
+	expect(tracee, end - 5, 64, "open!", false, "string running into unmapped memory");
+
+	bool threw = false;
+	try {
+		tracee.read_string(end, 64);
+	} catch(const tracer_exception&) {
+		threw = true;
+	}
+	check(threw, "string in unmapped memory throws");
+
+	check(tracee.resume_and_wait(EXITED) && WIFEXITED(tracee.status()) && WEXITSTATUS(tracee.status()) == 0,
+	      "tracee exits normally");
+}
+
+int main() {
+	try {
+		for(enum memory_backend backend : { MEMORY_PTRACE, MEMORY_PROCESS_VM, MEMORY_PROC_MEM }) {
+			for(size_t cache_pages : { 0, 8 }) {
+				try {
+					run(backend, cache_pages);
+				} catch(const tracer_exception& e) {
+					throw tracer_exception(std::string(e.what()) + " (backend " + std::to_string(backend)
+					                       + ", " + std::to_string(cache_pages) + " pages)");
+				}
+			}
+		}
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
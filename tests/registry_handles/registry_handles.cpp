@@ -0,0 +1,119 @@
+#include <unistd.h>       // fork, _exit
+#include <sys/wait.h>     // waitpid, WIFEXITED, WEXITSTATUS
+#include <cstdio>         // printf
+#include <algorithm>      // std::max
+#include <string>
+#include <vector>
+#include "tracer.hpp"
+#include "tracer_registry.hpp"
+#include "tracer_session.hpp"
+
+/* Traces a workload that forks short-lived children one after another,
+   once through a session and once through a lone tracer, and checks the
+   handles of the children's tracers: each stays valid until its tracer is
+   released, its slot is then reused, and the old handle never resolves
+   to the slot's new tracer. */
+
+static const int n_children = 40;
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static void workload() {
+	for(int i = 0; i < n_children; i++) {
+		const pid_t child = fork();
+		if(child == 0) {
+			_exit(0);
+		}
+		int status = 0;
+		if(waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			_exit(1);
+		}
+	}
+	_exit(0);
+}
+
+static void in_session() {
+	tracer_session session;
+	if(session.fork() == 0) {
+		workload();
+	}
+	tracer_registry& registry = session.registry();
+	std::vector<tracer_handle> released;
+	tracer_handle exited = { UINT32_MAX, 0 };
+	uint32_t highest_index = 0;
+	uint32_t highest_generation = 0;
+	struct tracer_event event;
+	while(session.next_event(event)) {
+		if(exited.index != UINT32_MAX) {
+			check(registry.get(exited) == NULL, "handle is stale after the event following the exit");
+			released.push_back(exited);
+			exited.index = UINT32_MAX;
+		}
+		const tracer_handle handle = event.tracer->handle();
+		check(registry.get(handle) == event.tracer, "handle resolves to its tracer");
+		for(const tracer_handle& old : released) {
+			check(old.index != handle.index || old.generation < handle.generation, "reused slots get a new generation");
+			if(old.index == handle.index) {
+				registry.release(old);
+				check(registry.get(handle) == event.tracer, "releasing a stale handle leaves the slot's new tracer");
+			}
+		}
+		highest_index = std::max(highest_index, handle.index);
+		highest_generation = std::max(highest_generation, handle.generation);
+		if(event.stop_reason == EXITED) {
+			check(session.find(event.tracer->process_id()) == NULL, "exited tracee is not found by pid");
+			exited = handle;
+			continue;
+		}
+		event.tracer->resume(FORKED);
+	}
+	check(highest_index < 4, "slots are reused");
+	check(highest_generation > 0, "generations advance");
+}
+
+static void lone_tracer() {
+	tracer tracee;
+	if(tracee.fork() == 0) {
+		workload();
+	}
+	tracee.set_trace_children(true);
+	std::vector<tracer_handle> forked;
+	while(tracee.resume_and_wait(FORKED)) {
+		const tracer_handle handle = tracee.children().back();
+		tracer *child = tracee.child(handle);
+		check(child != NULL && child->registry() == tracee.registry(), "child lives in the parent's registry");
+		for(const tracer_handle& old : forked) {
+			check(old.index != handle.index || old.generation < handle.generation, "reused slots get a new generation");
+		}
+		forked.push_back(handle);
+		check(child->resume_and_wait(EXITED), "child exits");
+	}
+	check(WIFEXITED(tracee.status()) && WEXITSTATUS(tracee.status()) == 0, "tracee exits normally");
+	check(forked.size() == n_children, "every fork is reported");
+	check(tracee.children().size() < n_children, "finished children are dropped from children()");
+	size_t released = 0;
+	for(const tracer_handle& handle : forked) {
+		tracer *child = tracee.child(handle);
+		released += (child == NULL ? 1 : 0);
+		check(child == NULL || child->stop_reason() == EXITED, "kept child still has its tracer");
+	}
+	check(released > 0, "finished children are released");
+	size_t slots = 0;
+	tracee.registry()->for_each([&slots](tracer&) { slots++; });
+	check(slots < n_children, "slots are reused");
+}
+
+int main() {
+	try {
+		in_session();
+		lone_tracer();
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
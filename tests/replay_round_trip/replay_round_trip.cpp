@@ -0,0 +1,140 @@
+#include <unistd.h>       // pipe, write, fork, _exit, unlink
+#include <poll.h>         // poll, POLLIN
+#include <signal.h>       // kill, SIGKILL
+#include <sys/wait.h>     // waitpid, WIFEXITED, WEXITSTATUS
+#include <sys/socket.h>   // socket, bind, listen, accept, getsockname
+#include <netinet/in.h>   // struct sockaddr_in, INADDR_LOOPBACK
+#include <arpa/inet.h>    // htonl
+#include <cstdio>         // printf
+#include <cstring>        // memset
+#include <string>
+#include "tracer.hpp"
+#include "trace_log.hpp"
+#include "syscall_replay.hpp"
+
+/* Records a workload that gets data back from the kernel through output
+   ints (pipe, wait4), structures it writes back (poll) and socket
+   addresses bounded by a socklen_t (getsockname, accept), and replays it.
+   The workload checks what it got, and exits with a distinct status at the
+   first thing that is wrong; both runs must exit with 0. The tracees are
+   forked without exec from the same call site, so they see the same
+   addresses without turning off address space randomization. */
+
+static const char *const log_path = "/tmp/replay_round_trip.log";
+
+static int workload() {
+	int fds[2];
+	if(pipe(fds) != 0 || write(fds[1], "x", 1) != 1) {
+		return 1;
+	}
+	struct pollfd pollfd = { fds[0], POLLIN, 0 };
+	if(poll(&pollfd, 1, 1000) != 1 || !(pollfd.revents & POLLIN)) {
+		return 2;
+	}
+	const pid_t child = fork();
+	if(child == 0) {
+		_exit(7);
+	}
+	int status = 0;
+	if(waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 7) {
+		return 3;
+	}
+	const int listener = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t length = sizeof(address);
+	if(bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 1) != 0
+	   || getsockname(listener, (struct sockaddr *)&address, &length) != 0
+	   || length != sizeof(address) || address.sin_port == 0) {
+		return 4;
+	}
+	const int client = socket(AF_INET, SOCK_STREAM, 0);
+	if(connect(client, (struct sockaddr *)&address, sizeof(address)) != 0) {
+		return 5;
+	}
+	// Anything written past the sockaddr_in lands in the canary.
+	struct {
+		struct sockaddr_in peer;
+		char canary[16];
+	} accepted;
+	memset(&accepted, 0x5a, sizeof(accepted));
+	length = sizeof(accepted.peer);
+	if(accept(listener, (struct sockaddr *)&accepted.peer, &length) < 0 || length != sizeof(accepted.peer)
+	   || accepted.peer.sin_addr.s_addr != htonl(INADDR_LOOPBACK)) {
+		return 6;
+	}
+	for(char c : accepted.canary) {
+		if(c != 0x5a) {
+			return 7;
+		}
+	}
+	return 0;
+}
+
+static int exit_status(const tracer& tracee) {
+	return (WIFEXITED(tracee.status()) ? WEXITSTATUS(tracee.status()) : -1);
+}
+
+static void record(tracer& tracee) {
+	trace_log_writer log(log_path);
+	while(tracee.resume_and_wait(SYSCALL_ENTRY)) {
+		log.syscall_entry(tracee);
+		if(!tracee.resume_and_wait(SYSCALL_EXIT)) {
+			break;
+		}
+		log.capture_outputs(tracee);
+		log.syscall_exit(tracee);
+	}
+	log.close();
+	if(exit_status(tracee) != 0) {
+		throw tracer_exception("Recorded workload exited with " + std::to_string(exit_status(tracee)) + ".");
+	}
+}
+
+static void replay(tracer& tracee) {
+	trace_log_reader log(log_path);
+	syscall_replayer replayer(log);
+	replayer.install(tracee);
+	try {
+		while(tracee.resume_and_wait(EMULATED_SYSCALL) && replayer.syscall_passthrough(tracee));
+	} catch(const tracer_exception&) {
+		kill(tracee.process_id(), SIGKILL);
+		throw;
+	}
+	if(exit_status(tracee) != 0) {
+		throw tracer_exception("Replayed workload exited with " + std::to_string(exit_status(tracee)) + ".");
+	}
+	if(replayer.events_replayed() == 0 || !replayer.finished()) {
+		throw tracer_exception("Replay did not use the whole log.");
+	}
+	printf("replayed=%lu passed_through=%lu\n", replayer.events_replayed(), replayer.events_passed_through());
+}
+
+/* Both tracees are forked here, so that the workload runs on the same
+   stack addresses in both. */
+static void run(bool recording) {
+	tracer tracee;
+	if(tracee.fork() == 0) {
+		_exit(workload());
+	}
+	if(recording) {
+		record(tracee);
+	} else {
+		replay(tracee);
+	}
+}
+
+int main() {
+	try {
+		run(true);
+		run(false);
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		unlink(log_path);
+		return 1;
+	}
+	unlink(log_path);
+	return 0;
+}
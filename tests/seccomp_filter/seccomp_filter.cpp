@@ -0,0 +1,106 @@
+#include <unistd.h>       // fork, getpid, _exit
+#include <sys/wait.h>     // waitpid, WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // syscall, SYS_getppid, SYS_getpid
+#include <cstdio>         // printf
+#include <string>
+#include "tracer.hpp"
+
+/* Traces a workload that calls getpid many times and getppid a few
+   times, with a seccomp filter selecting getppid only. Resumed with
+   SECCOMP, the tracee must stop at every getppid and nowhere else,
+   including in a child it forks, and the calls not selected must still
+   work. Resumed with SYSCALL_ENTRY, it must stop at every call. */
+
+static const int n_getpid = 50;
+static const int n_getppid = 3;
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static void workload(bool fork_child) {
+	const pid_t self = syscall(SYS_getpid);
+	for(int i = 0; i < n_getpid; i++) {
+		if(syscall(SYS_getpid) != self) {
+			_exit(1);
+		}
+	}
+	for(int i = 0; i < n_getppid; i++) {
+		syscall(SYS_getppid);
+	}
+	if(!fork_child) {
+		_exit(0);
+	}
+	const pid_t child = fork();
+	if(child == 0) {
+		_exit(syscall(SYS_getppid) == self ? 0 : 1);
+	}
+	int status = 0;
+	if(waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		_exit(2);
+	}
+	_exit(0);
+}
+
+// Stops at the seccomp stop of getppid in `tracee`, and checks its exit.
+static void expect_getppid(tracer& tracee, pid_t parent) {
+	check(tracee.stop_reason() == SECCOMP && tracee.get_syscall_number() == SYS_getppid,
+	      "seccomp stops are for getppid only");
+	tracee.resume(SYSCALL_EXIT);
+	check(tracee.wait() == SYSCALL_EXIT && tracee.get_syscall_return_value() == parent,
+	      "getppid completes after its seccomp stop");
+}
+
+static void filtered() {
+	tracer tracee;
+	if(tracee.fork({ SYS_getppid }) == 0) {
+		workload(true);
+	}
+	tracee.set_trace_children(true);
+	int stops = 0;
+	// The tracee then waits for its child; let the child run first.
+	for(tracee.resume(SECCOMP); tracee.wait() != FORKED; tracee.resume(SECCOMP)) {
+		stops++;
+		expect_getppid(tracee, getpid());
+	}
+	check(stops == n_getppid, "one stop per getppid");
+	tracer *child = tracee.child(tracee.children().back());
+	check(child != NULL, "child is traced");
+	check(child->resume_and_wait(SECCOMP), "child stops at getppid");
+	expect_getppid(*child, tracee.process_id());
+	check(!child->resume_and_wait(SECCOMP) && WIFEXITED(child->status()) && WEXITSTATUS(child->status()) == 0,
+	      "child exits normally");
+	check(tracee.resume_and_wait(EXITED) && WIFEXITED(tracee.status()) && WEXITSTATUS(tracee.status()) == 0,
+	      "tracee exits normally");
+}
+
+static void unfiltered_resume() {
+	tracer tracee;
+	if(tracee.fork({ SYS_getppid }) == 0) {
+		workload(false);
+	}
+	int getpid_entries = 0;
+	while(tracee.resume_and_wait(SYSCALL_ENTRY)) {
+		if(tracee.get_syscall_number() == SYS_getpid) {
+			getpid_entries++;
+		}
+		if(!tracee.resume_and_wait(SYSCALL_EXIT)) {
+			break;
+		}
+	}
+	check(getpid_entries == n_getpid + 1, "SYSCALL_ENTRY still stops at every call");
+	check(WIFEXITED(tracee.status()) && WEXITSTATUS(tracee.status()) == 0, "tracee exits normally");
+}
+
+int main() {
+	try {
+		filtered();
+		unfiltered_resume();
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
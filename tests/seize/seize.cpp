@@ -0,0 +1,180 @@
+#include <unistd.h>       // fork, pipe, read, write, close, access, _exit
+#include <fcntl.h>        // fcntl, O_NONBLOCK
+#include <pthread.h>      // pthread_create, pthread_join
+#include <sys/wait.h>     // waitpid, WUNTRACED, WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // syscall, SYS_getppid, SYS_read
+#include <cstdio>         // printf
+#include <set>
+#include <string>
+#include "tracer.hpp"
+#include "tracer_session.hpp"
+
+/* Seizes running processes that were not started traced: one busy in a
+   loop, one blocked in read, and, through a session, every thread of a
+   process and its child. Each must report INTERRUPTED, be traceable and
+   interruptible from there, and run on to a normal exit once detached,
+   with a blocked read restarted rather than failed and no stop signal
+   left behind. */
+
+static const long marker = 1;  // getppid argument of the busy loop
+static int ready_fd = -1;      // Write end on which `process_tree` reports it is ready
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+// Exits with 0 once it reads 'x' from `fd`.
+static void read_and_exit(int fd) {
+	char c = 0;
+	_exit(read(fd, &c, 1) == 1 && c == 'x' ? 0 : 1);
+}
+
+static void busy_loop(int fd) {
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	char c = 0;
+	while(read(fd, &c, 1) != 1) {
+		syscall(SYS_getppid, marker);
+	}
+	_exit(c == 'x' ? 0 : 1);
+}
+
+static void *thread_main(void *fd) {
+	char c = 0;
+	return (void *)(read((int)(long)fd, &c, 1) == 1 && c == 'x' ? 0L : 1L);
+}
+
+// Starts a thread and a child, all three then blocking in read, and reports on `ready_fd`.
+static void process_tree(int fd) {
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, thread_main, (void *)(long)fd) != 0) {
+		_exit(2);
+	}
+	const pid_t child = fork();
+	if(child == 0) {
+		read_and_exit(fd);
+	}
+	if(write(ready_fd, "r", 1) != 1) {
+		_exit(3);
+	}
+	char c = 0;
+	if(read(fd, &c, 1) != 1 || c != 'x') {
+		_exit(4);
+	}
+	void *result = NULL;
+	int status = 0;
+	pthread_join(thread, &result);
+	if(result != NULL || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		_exit(5);
+	}
+	_exit(0);
+}
+
+// Starts `child_main` untraced, with the read end of a pipe whose write end is returned.
+static pid_t start(void (*child_main)(int), int& fd) {
+	int fds[2];
+	check(pipe(fds) == 0, "pipe");
+	const pid_t pid = fork();
+	if(pid == 0) {
+		close(fds[1]);
+		child_main(fds[0]);
+	}
+	close(fds[0]);
+	fd = fds[1];
+	return pid;
+}
+
+// Lets the detached process go on and checks that it exits normally, without stopping.
+static void finish(pid_t pid, int fd, int n_readers, const std::string& what) {
+	for(int i = 0; i < n_readers; i++) {
+		check(write(fd, "x", 1) == 1, "write");
+	}
+	close(fd);
+	int status = 0;
+	check(waitpid(pid, &status, WUNTRACED) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0,
+	      what + " exits normally after detach");
+}
+
+static void seize_busy() {
+	int fd = -1;
+	const pid_t pid = start(busy_loop, fd);
+	tracer tracee;
+	tracee.seize(pid);
+	check(tracee.stop_reason() == INTERRUPTED, "seize stops with INTERRUPTED");
+	do {
+		check(tracee.resume_and_wait(SYSCALL_ENTRY), "seized tracee reaches getppid");
+	} while(tracee.get_syscall_number() != SYS_getppid);
+	check(tracee.get_syscall_argument(0) == marker, "registers of the seized tracee");
+	tracee.resume(INTERRUPTED);
+	tracee.interrupt();
+	check(tracee.wait() == INTERRUPTED, "interrupt stops a running tracee");
+	tracee.detach();
+	finish(pid, fd, 1, "busy tracee");
+}
+
+static void seize_blocked() {
+	int fd = -1;
+	const pid_t pid = start(read_and_exit, fd);
+	// Give the child time to block in read; seizing it earlier is fine too.
+	usleep(10000);
+	tracer tracee;
+	tracee.seize(pid);
+	check(tracee.stop_reason() == INTERRUPTED, "seize stops with INTERRUPTED");
+	check(tracee.resume_and_wait(SYSCALL_ENTRY) && tracee.get_syscall_number() == SYS_read, "read is restarted");
+	tracee.resume(SYSCALL_EXIT);
+	usleep(10000);
+	tracee.interrupt();
+	check(tracee.wait() == SYSCALL_EXIT, "interrupt in a blocked call stops at its exit");
+	do {
+		check(tracee.resume_and_wait(SYSCALL_ENTRY), "tracee goes back to read");
+	} while(tracee.get_syscall_number() != SYS_read);
+	tracee.detach();
+	finish(pid, fd, 1, "blocked tracee");
+}
+
+static void seize_process() {
+	int ready[2];
+	check(pipe(ready) == 0, "pipe");
+	ready_fd = ready[1];
+	int fd = -1;
+	const pid_t pid = start(process_tree, fd);
+	close(ready[1]);
+	char c = 0;
+	check(read(ready[0], &c, 1) == 1, "process tree starts");
+	close(ready[0]);
+	usleep(10000);
+
+	// The child process is only found through /proc/<pid>/task/<tid>/children.
+	const bool find_children = (access(("/proc/" + std::to_string(pid) + "/task/" + std::to_string(pid) + "/children").c_str(), R_OK) == 0);
+	tracer_session session;
+	const size_t n_seized = session.seize_process(pid, true);
+	check(n_seized == (find_children ? 3 : 2), "every thread and child is seized");
+	check(session.size() == n_seized, "seized threads are in the session");
+	std::set<pid_t> stopped;
+	struct tracer_event event;
+	while(stopped.size() < n_seized && session.next_event(event)) {
+		check(event.stop_reason == INTERRUPTED, "seized threads stop with INTERRUPTED");
+		check(event.tracer->process_id() == pid || event.tracer->thread_group_id() == pid || find_children,
+		      "seized thread belongs to the process");
+		stopped.insert(event.tracer->process_id());
+	}
+	check(stopped.size() == n_seized, "one stop per seized thread");
+	for(pid_t thread : stopped) {
+		session.find(thread)->detach();
+	}
+	check(session.size() == 0, "detached threads leave the session");
+	finish(pid, fd, 3, "process tree");
+}
+
+int main() {
+	try {
+		seize_busy();
+		seize_blocked();
+		seize_process();
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
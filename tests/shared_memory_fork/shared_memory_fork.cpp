@@ -0,0 +1,89 @@
+#include <unistd.h>       // fork, vfork, _exit
+#include <sys/wait.h>     // waitpid, WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // syscall, SYS_getppid
+#include <cstdio>         // printf
+#include <cstring>        // memcmp, memset
+#include <string>
+#include "tracer.hpp"
+
+/* Maps shared memory into a tracee, and checks that the bytes below its
+   stack pointer that the region's name went through are restored, that a
+   forked child gets a region of its own without disturbing the parent's,
+   and that a vfork child, which shares the parent's address space, shares
+   its region instead. */
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static void workload() {
+	syscall(SYS_getppid);
+	const pid_t child = fork();
+	if(child == 0) {
+		syscall(SYS_getppid);
+		_exit(0);
+	}
+	waitpid(child, NULL, 0);
+	if(vfork() == 0) {
+		_exit(0);
+	}
+	_exit(0);
+}
+
+static void run() {
+	tracer parent;
+	parent.set_trace_children(true);
+	if(parent.fork() == 0) {
+		workload();
+	}
+	do {
+		check(parent.resume_and_wait(SYSCALL_ENTRY), "tracee reaches getppid");
+	} while(parent.get_syscall_number() != SYS_getppid);
+
+	// The name of the region goes below the stack pointer.
+	char marker[512];
+	memset(marker, 0x5a, sizeof(marker));
+	void *below_stack = (void *)(parent.get_stack_pointer() - sizeof(marker));
+	check(parent.write_memory(below_stack, marker, sizeof(marker)) == sizeof(marker), "write below stack");
+	char *parent_region = (char *)parent.map_shared_memory(4096);
+	char after[sizeof(marker)];
+	check(parent.read_memory(below_stack, after, sizeof(after)) == sizeof(after), "read below stack");
+	check(memcmp(marker, after, sizeof(marker)) == 0, "memory below the stack pointer is restored");
+	parent_region[0] = 'P';
+
+	// fork: a region of its own, at the same address.
+	check(parent.resume_and_wait(FORKED), "tracee forks");
+	tracer *child = parent.child(parent.children().back());
+	check(child != NULL && child->shared_memory() != NULL, "forked child has a region");
+	check(child->shared_memory() != parent.shared_memory(), "forked child has its own region");
+	((char *)child->shared_memory())[0] = 'C';
+	char seen = 0;
+	check(child->read_memory(child->shared_memory_tracee_address(), &seen, 1) == 1 && seen == 'C',
+	      "child sees its own region");
+	check(parent.read_memory(parent.shared_memory_tracee_address(), &seen, 1) == 1 && seen == 'P',
+	      "parent's region is untouched");
+	check(child->resume_and_wait(EXITED) && WIFEXITED(child->status()) && WEXITSTATUS(child->status()) == 0,
+	      "forked child exits normally");
+
+	// vfork: same address space, same region.
+	check(parent.resume_and_wait(FORKED), "tracee vforks");
+	child = parent.child(parent.children().back());
+	check(child != NULL && child->shared_memory() == parent.shared_memory(), "vfork child shares the region");
+	check(child->resume_and_wait(EXITED), "vfork child exits");
+	check(parent.read_memory(parent.shared_memory_tracee_address(), &seen, 1) == 1 && seen == 'P',
+	      "parent's region survives the vfork child");
+	check(parent.resume_and_wait(EXITED) && WIFEXITED(parent.status()) && WEXITSTATUS(parent.status()) == 0,
+	      "tracee exits normally");
+}
+
+int main() {
+	try {
+		run();
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include <unistd.h>       // _exit
+#include <signal.h>       // kill, SIGUSR1
+#include <sys/syscall.h>  // syscall, SYS_getppid, SYS_getpid
+#include <cstdio>         // printf
+#include "stop_reason.hpp"
+#include "tracer.hpp"
+
+/* Checks `operator<` on stop reasons against the diagram in its
+   definition: a reason is less than exactly the reasons above it. Then
+   checks that stops are told apart after a `syscall_handler` answered a
+   call and the tracee stopped for a signal next: the following system
+   call stop must be an entry. */
+
+static const char *const names[] = {
+	"EXITED", "FORKED", "SYSCALL_ENTRY", "SYSCALL_EXIT", "SIGNALED", "STEPPED",
+	"SECCOMP", "EMULATED_SYSCALL", "INTERRUPTED", "NOT_STOPPED",
+};
+
+static const int n_reasons = NOT_STOPPED + 1;
+
+// Edges of the diagram, lower reason first.
+static const enum stop_reason edges[][2] = {
+	{ STEPPED, EXITED },
+	{ STEPPED, SIGNALED },
+	{ SIGNALED, SYSCALL_ENTRY },
+	{ SIGNALED, SYSCALL_EXIT },
+	{ SIGNALED, EMULATED_SYSCALL },
+	{ SYSCALL_ENTRY, FORKED }, { SYSCALL_EXIT, FORKED }, { EMULATED_SYSCALL, FORKED },
+	{ SYSCALL_ENTRY, SECCOMP }, { SYSCALL_EXIT, SECCOMP }, { EMULATED_SYSCALL, SECCOMP },
+	{ SYSCALL_ENTRY, INTERRUPTED }, { SYSCALL_EXIT, INTERRUPTED }, { EMULATED_SYSCALL, INTERRUPTED },
+};
+
+static volatile int spinning = 1;
+
+static bool entry_after_handler_and_signal() {
+	tracer tracee;
+	const pid_t pid = tracee.fork();
+	if(pid == 0) {
+		syscall(SYS_getppid);  // Answered by the handler
+		while(spinning);       // Until the tracer clears it at the signal stop
+		syscall(SYS_getpid);
+		_exit(0);
+	}
+	tracee.set_syscall_handler(SYS_getppid, [pid](tracer&, long, const long *) {
+		kill(pid, SIGUSR1);
+		return 0L;
+	});
+	tracee.resume(EMULATED_SYSCALL);
+	if(tracee.wait() != SIGNALED) {
+		printf("tracee did not stop for SIGUSR1 after the handler answered\n");
+		return false;
+	}
+	const int cleared = 0;
+	tracee.write_memory((void *)&spinning, &cleared, sizeof(cleared));
+	// A single stop; `resume_and_wait` would go on to the exit if misreported.
+	tracee.resume(SYSCALL_ENTRY);
+	const bool entry = (tracee.wait() == SYSCALL_ENTRY && tracee.get_syscall_number() == SYS_getpid);
+	if(!entry) {
+		printf("getpid was not reported as SYSCALL_ENTRY but as %s\n", names[tracee.stop_reason()]);
+	}
+	kill(pid, SIGKILL);
+	tracee.resume_and_wait(EXITED);
+	return entry;
+}
+
+int main() {
+	bool below[n_reasons][n_reasons] = {};
+	for(const auto& edge : edges) {
+		below[edge[0]][edge[1]] = true;
+	}
+	for(int k = 0; k < n_reasons; k++) {
+		for(int i = 0; i < n_reasons; i++) {
+			for(int j = 0; j < n_reasons; j++) {
+				below[i][j] = below[i][j] || (below[i][k] && below[k][j]);
+			}
+		}
+	}
+	int failures = 0;
+	for(int i = 0; i < n_reasons; i++) {
+		for(int j = 0; j < n_reasons; j++) {
+			const bool less = ((enum stop_reason)i < (enum stop_reason)j);
+			if(less != below[i][j]) {
+				printf("%s < %s should be %s\n", names[i], names[j], below[i][j] ? "true" : "false");
+				failures++;
+			}
+		}
+	}
+	if(!entry_after_handler_and_signal()) {
+		failures++;
+	}
+	return (failures == 0 ? 0 : 1);
+}
@@ -0,0 +1,107 @@
+#include <unistd.h>       // execl, _exit
+#include <pthread.h>      // pthread_create, pthread_join
+#include <sys/wait.h>     // WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // syscall, SYS_getppid, SYS_futex, SYS_execve
+#include <cstdio>         // printf
+#include <cstring>        // strcmp
+#include <string>
+#include "tracer.hpp"
+
+/* Traces a process that starts a thread, with `set_trace_threads`. The
+   thread must get a tracer of its own, in the same thread group, whose
+   registers are its own. When the thread calls execve, the group
+   leader's tracer must carry on with the new program from the exit of
+   execve, and the thread's tracer must report EXITED. */
+
+static const char *const exec_marker = "after exec";
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static void *thread_main(void *exec) {
+	syscall(SYS_getppid, 2);
+	if(exec != NULL) {
+		execl("/proc/self/exe", "thread_tracing", "exec", (char *)NULL);
+		_exit(2);
+	}
+	return NULL;
+}
+
+static void workload(bool exec) {
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, thread_main, (void *)exec) != 0) {
+		_exit(1);
+	}
+	syscall(SYS_getppid, 1);
+	pthread_join(thread, NULL);
+	_exit(0);
+}
+
+static void after_exec() {
+	syscall(SYS_getppid, exec_marker);
+	_exit(0);
+}
+
+static void stop_at_getppid(tracer& tracee) {
+	do {
+		check(tracee.resume_and_wait(SYSCALL_ENTRY), "tracee reaches getppid");
+	} while(tracee.get_syscall_number() != SYS_getppid);
+}
+
+static void run(bool exec) {
+	tracer leader;
+	if(leader.fork() == 0) {
+		workload(exec);
+	}
+	leader.set_trace_threads(true);
+	check(leader.resume_and_wait(FORKED), "tracee starts a thread");
+	tracer *thread = leader.child(leader.children().back());
+	check(thread != NULL, "thread has a tracer");
+	check(thread->thread_group_id() == leader.process_id() && thread->process_id() != leader.process_id(),
+	      "thread is in the leader's thread group");
+
+	stop_at_getppid(leader);
+	stop_at_getppid(*thread);
+	check(leader.get_syscall_argument(0) == 1 && thread->get_syscall_argument(0) == 2, "each thread has its own registers");
+
+	if(!exec) {
+		check(thread->resume_and_wait(EXITED) && thread->stop_reason() == EXITED, "thread exits");
+		check(leader.resume_and_wait(EXITED) && WIFEXITED(leader.status()) && WEXITSTATUS(leader.status()) == 0,
+		      "tracee exits normally");
+		return;
+	}
+	do {
+		check(thread->resume_and_wait(SYSCALL_ENTRY), "thread reaches execve");
+	} while(thread->get_syscall_number() != SYS_execve);
+	// Let the leader block in pthread_join; the exec kills it there, without a stop.
+	do {
+		check(leader.resume_and_wait(SYSCALL_ENTRY), "leader reaches pthread_join");
+	} while(leader.get_syscall_number() != SYS_futex);
+	leader.resume(SYSCALL_EXIT);
+	// The thread's own id disappears; only the leader's tracer can wait.
+	thread->resume(SYSCALL_EXIT);
+	check(leader.wait() == SYSCALL_EXIT && leader.get_syscall_number() == SYS_execve
+	      && leader.get_syscall_return_value() == 0, "leader's tracer continues at the exit of execve");
+	check(thread->stop_reason() == EXITED, "thread's tracer reports EXITED");
+	stop_at_getppid(leader);
+	check(leader.read_string((void *)leader.get_syscall_argument(0), 64) == exec_marker, "memory of the new program");
+	check(leader.resume_and_wait(EXITED) && WIFEXITED(leader.status()) && WEXITSTATUS(leader.status()) == 0,
+	      "new program exits normally");
+}
+
+int main(int argc, char **argv) {
+	if(argc > 1 && strcmp(argv[1], "exec") == 0) {
+		after_exec();
+	}
+	try {
+		run(false);
+		run(true);
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,89 @@
+#include <unistd.h>       // read, close, _exit, unlink
+#include <fcntl.h>        // open
+#include <sys/mman.h>     // mmap, MAP_PRIVATE
+#include <sys/wait.h>     // WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // SYS_read, SYS_mmap
+#include <cstdio>         // printf
+#include <string>
+#include "tracer.hpp"
+#include "trace_log.hpp"
+
+/* Records a tracee that reads more than the writer's capture limit and
+   maps a file, and checks that the read's captures were cut to the limit
+   and flagged, that the log still reads back event by event, and that the
+   mapped file was only captured when asked to. */
+
+static const char *const log_path = "/tmp/trace_log_limits.log";
+
+static const size_t max_captures_length = 4096;
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static void workload() {
+	static char buffer[65536];
+	const int fd = open("/proc/self/exe", O_RDONLY);
+	if(fd == -1 || read(fd, buffer, sizeof(buffer)) != sizeof(buffer)
+	   || mmap(NULL, 4096, PROT_READ, MAP_PRIVATE, fd, 0) == MAP_FAILED) {
+		_exit(1);
+	}
+	close(fd);
+	_exit(0);
+}
+
+static void record(bool capture_mapped_files) {
+	tracer tracee;
+	if(tracee.fork() == 0) {
+		workload();
+	}
+	trace_log_writer log(log_path);
+	log.set_max_captures_length(max_captures_length);
+	log.set_capture_mapped_files(capture_mapped_files);
+	while(tracee.resume_and_wait(SYSCALL_ENTRY)) {
+		log.syscall_entry(tracee);
+		if(!tracee.resume_and_wait(SYSCALL_EXIT)) {
+			break;
+		}
+		log.capture_outputs(tracee);
+		log.syscall_exit(tracee);
+	}
+	log.close();
+	check(WIFEXITED(tracee.status()) && WEXITSTATUS(tracee.status()) == 0, "workload succeeds");
+}
+
+static void check_log(bool capture_mapped_files) {
+	trace_log_reader log(log_path);
+	bool saw_read = false;
+	bool saw_mmap = false;
+	for(const struct syscall_event& event : log) {
+		check(event.size <= sizeof(struct syscall_event) + max_captures_length, "captures stay within the limit");
+		if(event.syscall_number == SYS_read && event.return_value == 65536) {
+			saw_read = true;
+			check(event.flags & SYSCALL_EVENT_TRUNCATED, "cut read is flagged");
+			check(event.n_captures == 1 && event.captures()->length > 0, "cut read keeps what fits");
+		} else if(event.syscall_number == SYS_mmap && event.arguments[4] >= 0 && !(event.arguments[3] & MAP_ANONYMOUS)
+		          && event.return_value > 0 && event.arguments[1] == 4096) {
+			saw_mmap = true;
+			check((event.n_captures == 1) == capture_mapped_files, "mapped file captured only when asked to");
+		}
+	}
+	check(saw_read && saw_mmap, "read and mmap are in the log");
+}
+
+int main() {
+	try {
+		for(bool capture_mapped_files : { false, true }) {
+			record(capture_mapped_files);
+			check_log(capture_mapped_files);
+		}
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		unlink(log_path);
+		return 1;
+	}
+	unlink(log_path);
+	return 0;
+}
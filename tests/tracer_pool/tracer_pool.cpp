@@ -0,0 +1,149 @@
+#include <unistd.h>       // fork, _exit
+#include <sys/wait.h>     // waitpid, WIFEXITED, WEXITSTATUS
+#include <sys/syscall.h>  // syscall, SYS_getppid
+#include <cstdio>         // printf
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tracer_pool.hpp"
+
+/* Spawns tracees on a pool of two workers, each forking a child of its
+   own, and checks that every stop of a tracee and of its children is
+   handled on one worker, that the tracees are spread over both workers,
+   that `execute` runs on the owning worker and can resume a tracee the
+   handler left stopped, and that a child whose `child_main` throws exits
+   with 127 instead of running on as a copy of the worker. */
+
+static const int n_tracees = 4;
+static const int n_getppid = 100;
+static const long marker_child = 7;  // getppid argument of the tracees' own children
+static const long marker_hold = 42;  // getppid argument at which the handler leaves the tracee stopped
+
+static void check(bool condition, const std::string& what) {
+	if(!condition) {
+		throw tracer_exception("Check failed: " + what);
+	}
+}
+
+static void workload() {
+	for(int i = 0; i < n_getppid; i++) {
+		syscall(SYS_getppid, 0);
+	}
+	const pid_t child = fork();
+	if(child == 0) {
+		syscall(SYS_getppid, marker_child);
+		_exit(0);
+	}
+	int status = 0;
+	if(waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		_exit(1);
+	}
+	syscall(SYS_getppid, marker_hold);
+	_exit(0);
+}
+
+struct observations {
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::map<pid_t, std::thread::id> workers;   // Thread that handled the stops of each tracee
+	std::map<pid_t, pid_t> parents;             // Of the tracees' children, from getppid
+	std::map<pid_t, int> getppid_entries;
+	std::map<pid_t, int> exit_statuses;
+	std::vector<pid_t> held;
+	bool mixed_workers = false;
+};
+
+static void handle(struct observations& seen, tracer& tracee, enum stop_reason reason) {
+	std::unique_lock<std::mutex> lock(seen.mutex);
+	const pid_t pid = tracee.process_id();
+	auto worker = seen.workers.find(pid);
+	if(worker == seen.workers.end()) {
+		seen.workers[pid] = std::this_thread::get_id();
+	} else if(worker->second != std::this_thread::get_id()) {
+		seen.mixed_workers = true;
+	}
+	if(reason == EXITED) {
+		seen.exit_statuses[pid] = (WIFEXITED(tracee.status()) ? WEXITSTATUS(tracee.status()) : -1);
+		seen.changed.notify_all();
+		return;
+	}
+	if(reason == SYSCALL_ENTRY && tracee.get_syscall_number() == SYS_getppid) {
+		const long marker = tracee.get_syscall_argument(0);
+		if(marker == 0) {
+			seen.getppid_entries[pid]++;
+		} else if(marker == marker_hold) {
+			seen.held.push_back(pid);
+			seen.changed.notify_all();
+			return;
+		}
+	} else if(reason == SYSCALL_EXIT && tracee.get_syscall_number() == SYS_getppid && tracee.get_syscall_argument(0) == marker_child) {
+		seen.parents[pid] = tracee.get_syscall_return_value();
+	}
+	tracee.resume(SYSCALL_ENTRY);
+}
+
+static void run() {
+	struct observations seen;
+	tracer_pool pool(2, [&seen](tracer& tracee, enum stop_reason reason) { handle(seen, tracee, reason); });
+	std::vector<pid_t> tracees;
+	for(int i = 0; i < n_tracees; i++) {
+		tracees.push_back(pool.spawn(workload).get());
+	}
+	// Prints its message to stderr, then exits.
+	const pid_t failing = pool.spawn([]() { throw tracer_exception("child_main failed, as expected"); }).get();
+
+	{
+		std::unique_lock<std::mutex> lock(seen.mutex);
+		check(seen.changed.wait_for(lock, std::chrono::seconds(30), [&seen]() { return seen.held.size() == n_tracees; }),
+		      "every tracee reaches the held getppid");
+	}
+	for(pid_t pid : tracees) {
+		std::thread::id owner;
+		{
+			std::lock_guard<std::mutex> lock(seen.mutex);
+			owner = seen.workers[pid];
+		}
+		pool.execute(pid, [owner](tracer& tracee) {
+			check(std::this_thread::get_id() == owner, "execute runs on the owning worker");
+			tracee.resume(SYSCALL_ENTRY);
+		}).get();
+	}
+	bool threw = false;
+	try {
+		pool.execute(1, [](tracer&) {}).get();
+	} catch(const tracer_exception&) {
+		threw = true;
+	}
+	check(threw, "execute on an unknown tracee fails");
+	pool.shutdown();
+
+	check(!seen.mixed_workers, "every tracee is handled by one worker");
+	std::set<std::thread::id> used;
+	for(pid_t pid : tracees) {
+		used.insert(seen.workers[pid]);
+		check(seen.getppid_entries[pid] == n_getppid, "every stop is handled");
+		check(seen.exit_statuses.count(pid) == 1 && seen.exit_statuses[pid] == 0, "tracee exits normally");
+	}
+	check(used.size() == 2, "tracees are spread over the workers");
+	check(seen.parents.size() == n_tracees, "children of tracees are traced");
+	for(const auto& child : seen.parents) {
+		check(seen.workers[child.first] == seen.workers[child.second], "children are handled by their parent's worker");
+		check(seen.exit_statuses[child.first] == 0, "child exits normally");
+	}
+	check(seen.exit_statuses.count(failing) == 1 && seen.exit_statuses[failing] == 127, "failing child exits with 127");
+}
+
+int main() {
+	try {
+		run();
+	} catch(const tracer_exception& e) {
+		printf("%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}